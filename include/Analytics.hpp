@@ -0,0 +1,43 @@
+#pragma once
+
+#include <ostream>
+#include <vector>
+
+#include "Group.hpp"
+
+namespace van_kampen
+{
+    struct AnalyticsParameters
+    {
+        std::size_t threads = 1;        // Number of worker threads
+        std::size_t exactLimit = 20000; // Eccentricities of all nodes are computed up to this nodes count
+        std::size_t samples = 16;       // BFS sources of approximate eccentricities on larger diagrams, zero for exact ones
+    };
+
+    struct AnalyticsReport
+    {
+        std::size_t nodes = 0, edges = 0, cells = 0, components = 0;
+        std::size_t boundaryLength = 0;
+        std::vector<std::size_t> degrees;          // Number of nodes of every degree
+        std::vector<std::size_t> terminalDistance; // Number of nodes at every distance from terminal
+        double meanTerminalDistance = 0.0;
+
+        // Eccentricities are taken in component of terminal, if they are not
+        // exact, diameter and radius are the best found bounds
+        bool exact = true;
+        std::size_t sources = 0; // Number of nodes eccentricities were computed for
+        std::size_t diameter = 0, diameterUpperBound = 0;
+        std::size_t radius = 0, radiusLowerBound = 0;
+    };
+
+    // Compute statistics of diagram with parallel direction-optimizing BFS
+    // Up to exactLimit nodes eccentricities of all nodes are found by
+    // bit-parallel BFS from 64 sources at once, otherwise BFS is run from
+    // samples nodes alternately farthest from the previous ones and with the
+    // least eccentricity lower bound, which gives diameter lower bound and
+    // radius upper bound; result is same for any threads count
+    AnalyticsReport analyzeDiagram(const Graph &graph, const Diagramm &diagramm, const AnalyticsParameters &parameters);
+
+    // Print report as JSON object
+    void printAnalytics(const AnalyticsReport &report, std::ostream &os);
+} // namespace van_kampen
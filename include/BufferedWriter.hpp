@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <ostream>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace van_kampen
+{
+    // Fixed size buffer in front of ostream
+    // Formats numbers without locale and writes to ostream only in large blocks
+    class BufferedWriter
+    {
+    public:
+        explicit BufferedWriter(std::ostream &os, std::size_t capacity = 1 << 16)
+            : os_(os), buffer_(capacity) {}
+
+        BufferedWriter(const BufferedWriter &) = delete;
+        BufferedWriter &operator=(const BufferedWriter &) = delete;
+
+        ~BufferedWriter() { flush(); }
+
+        BufferedWriter &operator<<(std::string_view text)
+        {
+            if (text.size() > buffer_.size() - size_)
+            {
+                flush();
+                if (text.size() > buffer_.size())
+                {
+                    os_.write(text.data(), text.size());
+                    return *this;
+                }
+            }
+            std::copy(text.begin(), text.end(), buffer_.begin() + size_);
+            size_ += text.size();
+            return *this;
+        }
+
+        BufferedWriter &operator<<(char c)
+        {
+            return *this << std::string_view(&c, 1);
+        }
+
+        // Doubles are printed with two digits after point
+        template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+        BufferedWriter &operator<<(T value)
+        {
+            char number[64];
+            std::to_chars_result result;
+            if constexpr (std::is_floating_point_v<T>)
+            {
+                result = std::to_chars(number, number + sizeof(number), value, std::chars_format::fixed, 2);
+            }
+            else
+            {
+                result = std::to_chars(number, number + sizeof(number), value);
+            }
+            return *this << std::string_view(number, result.ptr - number);
+        }
+
+        void flush()
+        {
+            os_.write(buffer_.data(), size_);
+            size_ = 0;
+        }
+
+    private:
+        std::ostream &os_;
+        std::vector<char> buffer_;
+        std::size_t size_ = 0;
+    };
+} // namespace van_kampen
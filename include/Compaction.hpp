@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+
+#include "Graph.hpp"
+
+namespace van_kampen
+{
+    enum class nodeOrder
+    {
+        // Breadth first from root, neighbours in rotation order
+        BFS,
+
+        // Reverse Cuthill-McKee: breadth first from pseudo-peripheral node
+        // found from root, neighbours by increasing degree, then reversed
+        RCM,
+    };
+
+    // Returns nodes which are not removed in order keeping neighbours close,
+    // to be passed to Graph::compact or Diagramm::compact
+    // Nodes unreachable from root follow, ordered the same way from the
+    // least of them
+    std::vector<nodeId_t> localityOrder(const Graph &graph, nodeId_t root, nodeOrder order);
+} // namespace van_kampen
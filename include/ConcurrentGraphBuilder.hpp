@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "Group.hpp"
+
+namespace van_kampen
+{
+    // Graph nodes and transitions added from many threads at once
+    // Ids are taken by threads in chunks with one atomic counter, nodes are
+    // kept in segments of growing size which are never moved, so node
+    // references stay valid while other threads add nodes
+    // Transitions may be added from many threads if every node is changed by
+    // one of them only; nodes are moved to graph by build
+    class ConcurrentGraphBuilder
+    {
+    public:
+        // Ids are taken by allocators in chunks of given size
+        explicit ConcurrentGraphBuilder(std::size_t chunkSize = 1024);
+
+        ConcurrentGraphBuilder(const ConcurrentGraphBuilder &) = delete;
+        ConcurrentGraphBuilder &operator=(const ConcurrentGraphBuilder &) = delete;
+
+        ~ConcurrentGraphBuilder();
+
+        // Ids of one thread, unused ids of its last chunk are left as gaps
+        class Allocator
+        {
+        public:
+            nodeId_t addNode();
+
+        private:
+            explicit Allocator(ConcurrentGraphBuilder &builder) noexcept;
+
+            ConcurrentGraphBuilder &builder_;
+            nodeId_t next_ = 0, end_ = 0;
+
+            friend class ConcurrentGraphBuilder;
+        };
+
+        Allocator allocator() noexcept;
+
+        // Add node with id of its own, without chunk
+        nodeId_t addNode();
+
+        // Transitions of node, in clockwise order as in Node
+        transitionList_t &transitions(nodeId_t);
+
+        // Returns number of ids taken, including gaps
+        std::size_t size() const noexcept;
+
+        // Move nodes to empty graph in canonical order, so that ids are dense
+        // and do not depend on how they were taken: breadth first from root
+        // along transitions, then nodes not reached from root in order of ids
+        // Transitions are moved in parallel unless graph has event log
+        // Returns graph id of every builder id, nonexistant node for gaps
+        std::vector<nodeId_t> build(Graph &graph, nodeId_t root, std::size_t threads);
+
+    private:
+        struct Slot
+        {
+            transitionList_t transitions;
+            bool used = false;
+        };
+
+        // Segment k has chunkSize * 2^k slots, enough for 64-bit ids
+        static const std::size_t segmentsCount = 48;
+
+        // Returns slot of id, its segment is allocated by the first thread
+        // which needs it
+        Slot &slot(nodeId_t);
+
+        // Returns the first of count new ids
+        nodeId_t take(std::size_t count);
+
+        const std::size_t chunkSize_;
+        std::atomic<std::size_t> size_{0};
+        std::array<std::atomic<Slot *>, segmentsCount> segments_;
+    };
+} // namespace van_kampen
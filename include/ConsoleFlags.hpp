@@ -5,6 +5,8 @@
 
 #include "cxxopts.hpp"
 
+#include "Compaction.hpp"
+#include "Generation.hpp"
 #include "Graph.hpp"
 
 namespace van_kampen
@@ -13,19 +15,57 @@ namespace van_kampen
     {
         ConsoleFlags(int argc, const char **argv);
 
+        // Returns parameters of generation set by flags
+        GenerationParameters generation() const;
+
         std::string inputFileName, outputFileName, wordOutputFileName;
         std::size_t cellsLimit = 0;
         std::size_t perLarge = 0;
+        std::size_t cacheSize = 1024;
+        std::size_t threads = 0;
+        std::size_t layoutIterations = 100;
+        std::size_t spectrumCount = 10;
+        std::size_t spectrumBins = 100;
+        std::size_t spectrumSteps = 100;
+        std::size_t analyzeSamples = 16;
+        std::size_t portfolio = 1;
+        std::size_t shards = 0;
+        std::size_t parts = 0;
+        std::size_t lodFanout = 64;
+        std::size_t affinityK = 2;
+        std::size_t lookaheadWidth = 4;
+        std::size_t lookaheadDepth = 1;
+        std::size_t maxMemory = 0;
+        std::uint64_t seed = 1;
         bool shuffleGroup = false;
         bool quiet = false;
         bool hasCellsLimit = false;
         bool iterativeAlgo = true;
         bool mergingAlgo = false;
         bool largeFirstAlgo = false;
+        bool shardedAlgo = false;
+        bool lookaheadAlgo = false;
         bool notSort = false;
+        bool affinityOrder = false;
         bool split = true;
+        bool lod = false;
+        bool layout = false;
+        bool portfolioAll = false;
+        bool scheduled = false;
+        bool verify = false;
+        bool compact = false;
+        van_kampen::nodeOrder compactOrder = van_kampen::nodeOrder::BFS;
+        std::string compactOrderString = "bfs";
         std::string outputFileNameWoEx;
         van_kampen::graphOutputFormat outputFormat = van_kampen::graphOutputFormat::DOT;
         std::string outputFormatString = "edges";
+        std::string cacheDirectory;
+        std::string coordinatesFileName;
+        std::string crossingsFileName;
+        std::string spectrumFileName;
+        std::string facesFileName;
+        std::string analyzeFileName;
+        std::string eventLogFileName;
+        std::string loadFileName;
     };
 } // namespace van_kampen
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include "Geometry.hpp"
+#include "Graph.hpp"
+
+namespace van_kampen
+{
+    struct CrossingParameters
+    {
+        std::size_t threads = 1;      // Number of worker threads
+        std::size_t maxListed = 1000; // Number of crossing pairs to list, all of them are counted
+    };
+
+    struct EdgeCrossing
+    {
+        std::pair<nodeId_t, nodeId_t> first, second; // Edges, smaller node first
+        Point at;                                     // Crossing point
+    };
+
+    struct CrossingReport
+    {
+        std::size_t edges = 0;     // Edges between distinct nodes, parallel ones are counted once
+        std::size_t crossings = 0; // Pairs of crossing edges without common nodes
+        std::vector<EdgeCrossing> listed;
+    };
+
+    // Count crossing edges of positioned graph
+    // Edges are put into cells of uniform grid sized by average edge length,
+    // pairs of edges sharing a cell are tested there, so time is
+    // O(E + K + sum of pairs per cell) which is close to O(E + K) for layouts
+    // with edges of similar lengths; cells are processed in parallel
+    // Crossings are listed in order of cells, independent of threads count
+    CrossingReport countCrossings(const Graph &graph, const CrossingParameters &parameters);
+
+    // Print report: summary line, then "<u> <v> <w> <z> <x> <y>" per listed
+    // crossing of edges u-v and w-z at point (x, y)
+    void printCrossings(const CrossingReport &report, std::ostream &os);
+} // namespace van_kampen
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <vector>
+
+#include "Graph.hpp"
+
+namespace van_kampen
+{
+    // Compressed sparse row adjacency of graph without removed nodes and loops
+    // Every transition is kept, so nondirected edge appears in lists of both ends
+    struct CsrGraph
+    {
+        explicit CsrGraph(const Graph &graph);
+
+        std::size_t size() const noexcept { return offsets.size() - 1; }
+        std::size_t degree(std::size_t v) const noexcept { return offsets[v + 1] - offsets[v]; }
+
+        std::vector<std::size_t> offsets; // Node v adjacent nodes are adjacent[offsets[v]..offsets[v + 1])
+        std::vector<nodeId_t> adjacent;
+    };
+} // namespace van_kampen
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+#include <functional>
 #include <vector>
 
 #include "Group.hpp"
@@ -12,8 +14,26 @@ namespace van_kampen
         virtual van_kampen::Diagramm &diagramm() = 0;
         virtual ~DiagrammGeneratingAlgorithm() = default;
         van_kampen::Graph &graph() { return *graph_; }
+        std::shared_ptr<van_kampen::Graph> sharedGraph() const { return graph_; }
+
+        // Generation finishes early once flag is set from other thread, diagram stays valid
+        const std::atomic_bool *stop = nullptr;
+
+        // Called in generating thread after relations are bound with their
+        // number, see SteppedGeneration
+        std::function<void(std::size_t)> onCellsBound;
 
     protected:
+        bool isStopped() const { return stop && stop->load(std::memory_order_relaxed); }
+
+        void cellsBound(std::size_t count = 1) const
+        {
+            if (onCellsBound)
+            {
+                onCellsBound(count);
+            }
+        }
+
         std::shared_ptr<van_kampen::Graph> graph_ = std::make_shared<van_kampen::Graph>();
     };
 } // namespace van_kampen
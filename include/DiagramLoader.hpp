@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+
+#include "Group.hpp"
+
+namespace van_kampen
+{
+    // Load diagram written by vankamp-vis to diagramm based on empty graph,
+    // so it can be split, converted or analyzed without generation
+    // File is mapped to memory, format is detected from its contents: binary
+    // diagram or graph written by writeBinary, dot or edges text
+    // Text is parsed by threads in parallel, see Graph::readText; it has no
+    // terminal and cells, so diagram gets no boundary circuit
+    // Returns format of file, BINARY for both binary ones
+    graphOutputFormat loadDiagram(const std::string &fileName, Graph &graph, Diagramm &diagramm, std::size_t threads);
+} // namespace van_kampen
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "Group.hpp"
+
+namespace van_kampen
+{
+    // Set priority of every transition to sum of 1 / length of cells it borders
+    // Edges of cells which do not exist anymore are skipped, parallel edges
+    // get priority on the first of them
+    // Priorities are not recorded in undo log, graph must not be in transaction
+    void computeEdgePriorities(Graph &graph, const CellLog &cells, std::size_t threads);
+} // namespace van_kampen
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "BufferedWriter.hpp"
+#include "Group.hpp"
+
+namespace van_kampen
+{
+    enum class eventType : std::uint8_t
+    {
+        // Label name, later events refer to labels by their order
+        LABEL,
+
+        // Node with next id is added
+        NODE,
+
+        // Transition is added after or before all transitions of node
+        TRANSITION,
+        FRONT_TRANSITION,
+
+        // Last two transitions of node are swapped
+        SWAP_LAST,
+
+        // Nodes are merged, with list of untouchable nodes
+        MERGE,
+
+        // Edges between two nodes are removed
+        REMOVE_EDGE,
+
+        // Diagram terminal is set
+        TERMINAL,
+
+        // Nodes walked by cell bound to diagram
+        CELL,
+
+        // Number of cells of diagram, written after every bind and merge
+        CELLS,
+    };
+
+    // Append-only log of graph changes made while diagram is generated
+    // Every event is type byte followed by its arguments as varints, so log
+    // can be read while it is written and replayed into any output format
+    // Log is flushed to stream once enough data is buffered and a cell is done
+    class EventLog
+    {
+    public:
+        explicit EventLog(std::ostream &os);
+
+        EventLog(const EventLog &) = delete;
+        EventLog &operator=(const EventLog &) = delete;
+
+        ~EventLog();
+
+        void addNode();
+        void addTransition(nodeId_t from, const Transition &tr, bool front);
+        void swapLastAdditions(nodeId_t node);
+        void mergeNodes(nodeId_t alive, nodeId_t dead, const std::unordered_set<nodeId_t> &untouchable);
+        void removeOrientedEdge(nodeId_t a, nodeId_t b);
+        void setTerminal(nodeId_t node);
+        void addCell(const CellLog &cells, std::size_t cell);
+        void setCellsCount(std::size_t cells);
+
+        void flush();
+
+    private:
+        void put(eventType type);
+        void put(std::uint64_t value);
+        void putNode(nodeId_t node);
+
+        BufferedWriter writer_;
+        std::ostream &os_;
+        std::unordered_map<std::string, std::uint64_t> labelIds_;
+        std::size_t unflushed_ = 0;
+    };
+
+    struct ReplayResult
+    {
+        std::size_t events = 0;     // Number of replayed events
+        std::size_t cellEvents = 0; // Number of events up to the last cells event
+        std::size_t skipped = 0;    // Complete events after the last cell of incomplete log
+        std::size_t cells = 0;      // Number of replayed cells
+        bool complete = true;       // False if log ends in the middle of event
+    };
+
+    // Replay events of log into empty graph and diagram built on it
+    // Diagram gets every logged cell, nodes merged away are replaced in them
+    // Log which is still being written ends with incomplete event, such log
+    // is replayed up to its last cell; stream must be seekable
+    ReplayResult replayEventLog(std::istream &is, Graph &graph, Diagramm &diagramm);
+} // namespace van_kampen
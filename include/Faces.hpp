@@ -0,0 +1,30 @@
+#pragma once
+
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include "Group.hpp"
+
+namespace van_kampen
+{
+    // Transition given by its source node and index in source transitions list
+    using dart_t = std::pair<nodeId_t, std::size_t>;
+
+    // Faces of planar diagram
+    struct FaceList
+    {
+        std::size_t size() const noexcept { return offsets.size() - 1; }
+
+        std::vector<std::size_t> offsets = {0}; // Face i is darts[offsets[i]..offsets[i + 1])
+        std::vector<dart_t> darts;              // Face boundary walks
+        std::size_t outerFace = 0;              // Index of face outside of diagram
+    };
+
+    // Walk faces of diagram by rotation system given by transitions order
+    // Works in time linear in graph size
+    FaceList enumerateFaces(const Graph &graph, const Diagramm &diagramm);
+
+    // Print faces, one per line: node ids of boundary walk, then its label
+    void printFaces(const Graph &graph, const FaceList &faces, std::ostream &os);
+} // namespace van_kampen
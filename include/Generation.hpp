@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DiagramGeneratingAlgorithm.hpp"
+
+namespace van_kampen
+{
+    enum class algorithmType
+    {
+        ITERATIVE,
+        LARGE_FIRST,
+        MERGING,
+        SHARDED,
+        LOOKAHEAD,
+    };
+
+    // All parameters which affect generated diagram
+    struct GenerationParameters
+    {
+        algorithmType algorithm = algorithmType::ITERATIVE;
+        std::size_t cellsLimit = 0;     // Zero for no limit
+        std::size_t perLarge = 10;      // Small words used to build one big one (large-first)
+        bool shuffle = false;           // Shuffle relations before generation
+        std::uint64_t seed = 1;         // Seed of shuffle
+        bool sort = true;               // Sort relations by length before generation
+        bool affinity = false;          // Order relations by greedy chain of matching k-mers from hub
+        std::size_t affinityK = 2;      // Length of k-mers matched by affinity ordering
+        std::size_t shards = 0;         // Hub segments (sharded), threads count if zero
+        std::size_t threads = 0;        // Worker threads, all available if zero
+        bool scheduled = false;         // Retry relations by boundary changes (iterative)
+        std::size_t lookaheadWidth = 4; // Relations tried on every lookahead level
+        std::size_t lookaheadDepth = 1; // Levels of lookahead
+        bool quiet = true;              // Do not log progress to console
+    };
+
+    // Returns algorithm name as in command line flags
+    std::string algorithmName(algorithmType algorithm);
+
+    // Returns description of parameters which affect generated diagram
+    std::string describeParameters(const GenerationParameters &parameters);
+
+    // Order relations before generation as parameters say: shuffle, sort by
+    // length, then order by affinity, see orderByAffinity
+    // Last relation is hub, it stays last
+    void prepareWords(std::vector<std::vector<GroupElement>> &words, const GenerationParameters &parameters);
+
+    // Create configured algorithm
+    std::unique_ptr<DiagrammGeneratingAlgorithm> makeAlgorithm(const GenerationParameters &parameters);
+
+    // Returns circuit label in representation format: a*b^(-1)*c
+    std::string circuitToString(const std::vector<Transition> &circuit);
+} // namespace van_kampen
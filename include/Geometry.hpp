@@ -83,6 +83,28 @@ namespace van_kampen
         return polygon;
     }
 
+    // Returns doubled signed area of triangle, positive if a, b, c go counterclockwise
+    inline double orientation(const Point &a, const Point &b, const Point &c)
+    {
+        return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    }
+
+    // Returns if segments cross at point which is inner for both of them
+    // Touching and collinear segments do not cross
+    inline bool isCrossing(const Segment &s, const Segment &t)
+    {
+        double a = orientation(s.first, s.second, t.first), b = orientation(s.first, s.second, t.second);
+        double c = orientation(t.first, t.second, s.first), d = orientation(t.first, t.second, s.second);
+        return ((a > 0 && b < 0) || (a < 0 && b > 0)) && ((c > 0 && d < 0) || (c < 0 && d > 0));
+    }
+
+    // Returns crossing point of segments, they must cross
+    inline Point crossingPoint(const Segment &s, const Segment &t)
+    {
+        double a = orientation(t.first, t.second, s.first), b = orientation(t.first, t.second, s.second);
+        return s.first + (s.second - s.first) * (a / (a - b));
+    }
+
     // Returns distance between two points
     inline double distance(const Point &a, const Point &b)
     {
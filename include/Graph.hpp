@@ -1,15 +1,18 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <memory>
 #include <stdexcept>
 #include <unordered_set>
 #include <deque>
+#include <vector>
 
 #include "Group.hpp"
 #include "Geometry.hpp"
+#include "GraphStorage.hpp"
 
 namespace van_kampen
 {
@@ -26,15 +29,25 @@ namespace van_kampen
 
         // .edges - list of graph edges
         TXT_EDGES,
+
+        // .svg image drawn from node positions
+        SVG,
+
+        // .bin - graph or diagram written by writeBinary
+        BINARY,
     };
 
     class GroupElement;
     class Diagramm;
     class Graph;
+    class EventLog;
 
     struct Transition;
 
-    using nodeId_t = int;
+    using nodeId_t = std::int64_t;
+
+    // Nodes and transitions are kept in GraphStorage
+    using transitionList_t = std::deque<Transition, StorageAllocator<Transition>>;
 
     // Van Kanpmen graph node
     class Node
@@ -51,6 +64,12 @@ namespace van_kampen
 
         void addTransition(Transition &&);
 
+        // Add transition to existing node before all other transitions
+        void addFrontTransition(nodeId_t to,
+                                const GroupElement &label,
+                                bool isInSquare,
+                                bool isInHub);
+
         // Swap last two additions order
         void swapLastAdditions();
 
@@ -61,6 +80,7 @@ namespace van_kampen
 
         // Set is node highlighted on diagram
         void highlightNode(bool) noexcept;
+        bool isHighlighted() const noexcept;
 
         nodeId_t getId() const noexcept;
 
@@ -68,9 +88,11 @@ namespace van_kampen
         void setDiagramComment(const std::string &);
         void setDiagramLabel(std::string &&);
         void setDiagramComment(std::string &&);
+        const std::string &diagramLabel() const noexcept;
+        const std::string &diagramComment() const noexcept;
 
-        const std::deque<Transition> &transitions() const;
-        std::deque<Transition> &transitions();
+        const transitionList_t &transitions() const;
+        transitionList_t &transitions();
 
         static nodeId_t makeNonexistantNode() noexcept;
         static bool isNonexistantNode(nodeId_t) noexcept;
@@ -83,7 +105,7 @@ namespace van_kampen
         // Print all outgoing transitions
         void printTransitions(std::ostream &os, graphOutputFormat, bool last) const;
 
-        std::deque<Transition> transitions_; // List of node adjacent nodes
+        transitionList_t transitions_;       // List of node adjacent nodes
         bool isHighlighted_ = false;         // Is node marked as terminal on diagram
         Graph &graph_;                       // Corresponding graph reference
         const nodeId_t id_;                  // Node id in graph
@@ -106,7 +128,7 @@ namespace van_kampen
 
         // Get list of graph nodes
         // Returns const reference on list
-        const std::deque<Node> &nodes() const;
+        const std::deque<Node, StorageAllocator<Node>> &nodes() const;
 
         // Get graph node by id
         // Returns reference on node
@@ -121,14 +143,89 @@ namespace van_kampen
         // Removes edges a -> b, b -> a
         void removeOrientedEdge(nodeId_t, nodeId_t);
 
-        // Increase priority of directed edge from->to by double value
-        void increaseDirEdgePriority(nodeId_t from, nodeId_t to, double);
+        // Returns if node was merged into another one
+        bool isRemoved(nodeId_t) const;
+
+        // Drop removed nodes and transitions to them, node order[i] gets id i
+        // Order must list every node which is not removed once
+        // Returns new id of every old node, nonexistant node for removed ones
+        // Graph must not have event log or open transaction
+        std::vector<nodeId_t> compact(const std::vector<nodeId_t> &order);
+
+        // Write whole graph in compact binary form
+        void writeBinary(std::ostream &os) const;
+
+        // Read graph written by writeBinary
+        // Graph must be empty
+        void readBinary(std::istream &is);
 
-        // Increase priority of nondirected edge from->to by double value
-        void increaseNondirEdgePriority(nodeId_t, nodeId_t, double);
+        // Read graph printed by printSelf in dot or edges format, lines are
+        // parsed by threads in parallel; node ids are kept, ids which are not
+        // printed become removed nodes
+        // Text formats do not keep clockwise order of transitions: they are
+        // added in order of edges, reversed ones included
+        // Graph must be empty and must not have event log
+        void readText(const char *begin, const char *end, graphOutputFormat, std::size_t threads);
+
+        // Start transaction: changes made until it is committed or rolled back
+        // are recorded in undo log, transactions can be nested
+        // Graph must not have event log
+        void beginTransaction();
+
+        // Keep changes of the innermost transaction, they are rolled back
+        // with enclosing one
+        void commitTransaction();
+
+        // Undo changes of the innermost transaction in time linear in their number
+        void rollbackTransaction();
+
+        // Returns if there is an open transaction
+        bool inTransaction() const noexcept;
+
+        // Set if node positions are computed and should be printed
+        void setPositioned(bool) noexcept;
+        bool isPositioned() const noexcept;
+
+        // Set log all changes of graph are written to, nullptr to stop logging
+        // Log must outlive graph or be reset before
+        void setEventLog(EventLog *) noexcept;
+        EventLog *eventLog() const noexcept;
 
     private:
-        std::deque<Node> nodes_;
+        // Change recorded in undo log, named by the action which undoes it
+        enum class undoType : std::uint8_t
+        {
+            POP_NODE,      // Remove last node
+            POP_BACK,      // Remove last transition of node
+            POP_FRONT,     // Remove first transition of node
+            SWAP_LAST,     // Swap last two transitions of node
+            SET_TARGET,    // Set target of transition index to value
+            INSERT,        // Insert saved transition value at index
+            RESTORE_NODE,  // Node is not removed
+        };
+
+        struct UndoRecord
+        {
+            undoType type;
+            nodeId_t node;
+            nodeId_t value = 0; // Node id, target or index of saved transition
+            std::size_t index = 0;
+        };
+
+        // Record change if there is an open transaction
+        void logUndo(undoType type, nodeId_t node, nodeId_t value = 0, std::size_t index = 0);
+
+        // Record change undone by restoring transition
+        void logUndo(undoType type, nodeId_t node, const Transition &saved, std::size_t index = 0);
+
+        bool positioned_ = false;
+        EventLog *eventLog_ = nullptr;
+        std::deque<Node, StorageAllocator<Node>> nodes_;
         std::unordered_set<nodeId_t> removedNodes_;
+        std::vector<UndoRecord> undoLog_;
+        std::vector<Transition> savedTransitions_;
+        std::vector<std::pair<std::size_t, std::size_t>> savepoints_; // Undo log and saved transitions sizes
+
+        friend class Node;
     };
 } // namespace van_kampen
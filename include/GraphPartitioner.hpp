@@ -0,0 +1,49 @@
+#pragma once
+
+#include <deque>
+#include <ostream>
+#include <vector>
+
+#include "Graph.hpp"
+
+namespace van_kampen
+{
+    struct PartitionParameters
+    {
+        std::size_t parts = 0;        // Number of parts, by part size if zero
+        std::size_t partSize = 2000;  // Nodes per part when number of parts is not set
+        double imbalance = 0.05;      // Allowed excess of part size over average
+        std::size_t refinePasses = 8; // Refinement passes on every level
+        std::size_t threads = 1;      // Number of worker threads
+        unsigned seed = 1;            // Seed of matching order
+    };
+
+    // Edge between nodes of different parts
+    struct CutEdge
+    {
+        std::size_t fromPart, toPart;
+        nodeId_t from, to; // Node ids in part graphs
+        GroupElement label;
+    };
+
+    struct Partition
+    {
+        std::deque<Graph> parts;
+        std::vector<std::vector<nodeId_t>> globalIds; // Diagram node id of every part node
+        std::vector<CutEdge> cut;                     // Every nondirected edge once
+    };
+
+    // Multilevel partition of graph nodes into balanced parts with light cut
+    // Graph is coarsened by heavy edge matching on edge priorities, coarsest
+    // graph is partitioned by greedy growing, which is projected back and
+    // refined by boundary node moves on every level
+    // Returns part of every node, removed nodes get number of parts
+    std::vector<std::size_t> partitionGraph(const Graph &graph, PartitionParameters parameters);
+
+    // Build part graphs, nodes with cut edges are commented with their diagram ids
+    Partition splitToParts(const Graph &graph, const std::vector<std::size_t> &part, std::size_t threads);
+
+    // Print cut edges, one "<from part> <from node> <to part> <to node> <label>"
+    // per line, parts are numbered from one
+    void printCutEdges(const Partition &partition, std::ostream &os);
+} // namespace van_kampen
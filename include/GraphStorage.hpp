@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace van_kampen
+{
+    // Memory of graph nodes and transitions
+    // Blocks are taken from heap until heap part of storage reaches memory
+    // limit, later blocks are taken from file mapped into memory, so cold
+    // pages are written back to file by the system instead of filling RAM
+    // Heap keeps the earliest blocks, blocks are never moved to file later
+    // Only node and transition deques use it, labels, removed nodes, undo
+    // and saved transition logs are kept in heap outside of the limit
+    class GraphStorage
+    {
+    public:
+        // Set heap memory limit in bytes, zero for no limit
+        // Mapped file is created in directory, temporary one if empty, and
+        // deleted on exit; must be called before graphs are built
+        static void setMemoryLimit(std::size_t bytes, const std::string &directory = "");
+
+        static void *allocate(std::size_t bytes);
+        static void deallocate(void *block, std::size_t bytes) noexcept;
+
+        // Returns bytes of blocks in heap and in mapped file
+        static std::size_t heapBytes() noexcept;
+        static std::size_t mappedBytes() noexcept;
+    };
+
+    // Allocator of graph containers, takes memory from GraphStorage
+    template <typename T>
+    struct StorageAllocator
+    {
+        using value_type = T;
+
+        StorageAllocator() noexcept = default;
+
+        template <typename U>
+        StorageAllocator(const StorageAllocator<U> &) noexcept {}
+
+        T *allocate(std::size_t n)
+        {
+            return static_cast<T *>(GraphStorage::allocate(n * sizeof(T)));
+        }
+
+        void deallocate(T *block, std::size_t n) noexcept
+        {
+            GraphStorage::deallocate(block, n * sizeof(T));
+        }
+
+        template <typename U>
+        bool operator==(const StorageAllocator<U> &) const noexcept { return true; }
+
+        template <typename U>
+        bool operator!=(const StorageAllocator<U> &) const noexcept { return false; }
+    };
+} // namespace van_kampen
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <chrono>
+
 #include "Graph.hpp"
 #include "Geometry.hpp"
 
@@ -8,7 +10,7 @@ namespace van_kampen
     class Graph;
     class Node;
     struct Transition;
-    using nodeId_t = int;
+    using nodeId_t = std::int64_t;
 
     // Group element
     class GroupElement
@@ -32,7 +34,7 @@ namespace van_kampen
         void inverse() noexcept;
     };
 
-    using nodeId_t = int;
+    using nodeId_t = std::int64_t;
 
     // Transition in graph
     struct Transition
@@ -47,6 +49,26 @@ namespace van_kampen
         bool isInHub = false;
     };
 
+    // Cells of diagram as closed walks of node ids
+    struct CellLog
+    {
+        std::size_t size() const noexcept { return offsets.size() - 1; }
+
+        // Add cell walking nodes from range
+        template <typename It>
+        void add(It begin, It end)
+        {
+            nodes.insert(nodes.end(), begin, end);
+            offsets.push_back(nodes.size());
+        }
+
+        std::vector<std::size_t> offsets = {0}; // Cell i is nodes[offsets[i]..offsets[i + 1])
+        std::vector<nodeId_t> nodes;
+    };
+
+    // Diagram on graph
+    // Transitions of every node are kept in clockwise order, the last one
+    // continues boundary circuit and the first one goes back along it
     class Diagramm
     {
     public:
@@ -64,10 +86,65 @@ namespace van_kampen
         bool merge(Diagramm &&other, std::size_t hint = 0);
 
         nodeId_t getTerminal() const noexcept;
-        void setTerminal(nodeId_t) noexcept;
+        void setTerminal(nodeId_t);
+
+        // Returns number of cells added to diagram
+        std::size_t cellsCount() const noexcept;
+
+        // Returns cells added to diagram, edge priorities are computed from them
+        const CellLog &cells() const noexcept;
+        void setCells(CellLog &&);
+
+        // Returns labels of boundary path added by last successful bindWord
+        // with one old boundary letter on each side
+        const std::vector<GroupElement> &exposedSegment() const noexcept;
+
+        // Set number of threads matching one word against boundary, they are
+        // used only when word length times boundary length is large
+        void setMatchingThreads(std::size_t) noexcept;
+
+        // Returns time bindWord spent reading boundary and matching words
+        // against it, rolled back binds included
+        std::chrono::nanoseconds matchingTime() const noexcept;
+
+        // Add matching time of other diagram whose cells were moved to this one
+        void addMatchingTime(std::chrono::nanoseconds) noexcept;
+
+        // Compact graph in given node order, see Graph::compact, and renumber
+        // terminal and cells; removed nodes are dropped from cells
+        void compact(const std::vector<nodeId_t> &order);
+
+        // Start transaction on diagram and its graph, see Graph::beginTransaction
+        // Terminal, cells and exposed segment are restored on rollback
+        void beginTransaction();
+        void commitTransaction();
+        void rollbackTransaction();
+
+        // Write diagram with its graph in compact binary form
+        void writeBinary(std::ostream &os) const;
+
+        // Read diagram written by writeBinary, graph must be empty
+        void readBinary(std::istream &is);
 
     private:
+        // Write cells starting from given one and number of cells to event
+        // log of graph if there is one
+        void logCells(std::size_t first);
+
+        // State of diagram at transaction start
+        struct Savepoint
+        {
+            nodeId_t terminal;
+            std::size_t cells, cellNodes;
+            std::vector<GroupElement> exposed;
+        };
+
         nodeId_t terminal_ = -1;
+        CellLog cells_;
+        std::vector<Savepoint> savepoints_;
+        std::size_t matchingThreads_ = 1;
+        std::chrono::nanoseconds matchingTime_{0};
+        std::vector<GroupElement> exposed_;
         std::shared_ptr<Graph> graph_;
     };
 } // namespace van_kampen
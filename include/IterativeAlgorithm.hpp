@@ -1,6 +1,7 @@
 #pragma once
 
 #include "DiagramGeneratingAlgorithm.hpp"
+#include "VanKampenUtils.hpp"
 
 namespace van_kampen
 {
@@ -14,8 +15,16 @@ namespace van_kampen
 
         std::size_t cellsLimit = 0;
         bool quiet = false;
+        bool scheduled = false;  // Retry only relations woken by boundary changes, see RelationScheduler
+        std::size_t threads = 0; // Threads matching relation against large boundary, zero for all available
 
     private:
+        // Bind words after hub, trying relations queued by scheduler first
+        // and sweeping over all of them only when queue is empty
+        void generateScheduled(const std::vector<std::vector<van_kampen::GroupElement>> &words,
+                               ProcessLogger &logger,
+                               std::size_t totalIterations);
+
         van_kampen::Diagramm diagramm_;
     };
 } // namespace van_kampen
@@ -15,6 +15,7 @@ namespace van_kampen
         std::size_t cellsLimit = 0;
         bool quiet = false;
         int maximalSmallForOneBig = 10;
+        std::size_t threads = 0; // Threads matching relation against large boundary, zero for all available
 
     private:
         van_kampen::Diagramm diagramm_;
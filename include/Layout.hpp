@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+
+#include "Graph.hpp"
+
+namespace van_kampen
+{
+    struct LayoutParameters
+    {
+        std::size_t threads = 1;              // Number of worker threads
+        std::size_t embeddingIterations = 300; // Barycentric embedding iterations
+        std::size_t forceIterations = 100;     // Force-directed refinement iterations
+        double edgeLength = 1.0;               // Desired edge length
+    };
+
+    // Computes position of every graph node
+    // Nodes of circuit are pinned on circle, others are placed by barycentric
+    // embedding, which is refined with grid-approximated force-directed solver
+    void computeLayout(Graph &graph, const std::vector<Transition> &circuit, const LayoutParameters &parameters);
+
+    // Print positions of all graph nodes, one "<id> <x> <y>" per line
+    void printCoordinates(const Graph &graph, std::ostream &os);
+} // namespace van_kampen
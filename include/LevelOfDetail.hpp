@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Group.hpp"
+
+namespace van_kampen
+{
+    struct DetailParameters
+    {
+        std::size_t fanout = 64;         // Nodes of finer level per super-node
+        std::size_t overviewSize = 1000; // Levels are added until the top one is not larger
+        std::size_t threads = 1;         // Number of worker threads
+    };
+
+    // Nondirected weighted graph of one level, nodes of the first level are
+    // diagram nodes, nodes of next ones are super-nodes of previous level
+    struct DetailLevel
+    {
+        std::size_t size() const noexcept { return nodeWeight.size(); }
+
+        std::vector<std::size_t> offsets = {0}; // Node v neighbours are adjacent[offsets[v]..offsets[v + 1])
+        std::vector<std::size_t> adjacent;
+        std::vector<double> edgeWeight;       // Sum of priorities of diagram edges between nodes
+        std::vector<std::size_t> edgeCount;   // Number of diagram edges between nodes
+        std::vector<std::size_t> nodeWeight;  // Number of diagram nodes inside
+        std::vector<std::size_t> parent;      // Super-node of next level, empty on the top level
+    };
+
+    struct DetailHierarchy
+    {
+        std::vector<nodeId_t> diagramIds; // Diagram node of every first level node
+        std::vector<DetailLevel> levels;  // From diagram nodes to overview
+    };
+
+    // Contract diagram into levels of super-nodes
+    // First level super-nodes grow from cells, every diagram node starts in
+    // the first bound cell it belongs to, cells longer than fanout are cut into
+    // runs along their walk; then super-nodes of every level are
+    // joined by matching along edges of the largest priority relative to their
+    // size, until there are fanout times less of them
+    // Edge priorities must be computed; matching and contraction run in
+    // parallel and give same result for any threads count
+    DetailHierarchy buildDetailLevels(const Graph &graph, const CellLog &cells, const DetailParameters &parameters);
+
+    // Write hierarchy to directory:
+    // "overview.<extension>" with super-nodes of the top level,
+    // "<level>-<id>.<extension>" with nodes inside every super-node, which are
+    // commented with names of their own detail files, or with diagram ids on
+    // the first level if they have edges to other super-nodes,
+    // "levels.txt" with "<level> <id> <parent id> <diagram nodes>" lines
+    // Edges between super-nodes are labeled with number of diagram edges
+    void writeDetailLevels(const Graph &graph,
+                           const DetailHierarchy &hierarchy,
+                           const std::string &directory,
+                           graphOutputFormat format,
+                           const std::string &extension,
+                           std::size_t threads);
+} // namespace van_kampen
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "DiagramGeneratingAlgorithm.hpp"
+
+namespace van_kampen
+{
+    // Iterative algorithm which looks ahead before binding: the next width
+    // relations which bind are tried in transactions, each followed by
+    // depth - 1 more, and the one leading to the shortest boundary is bound;
+    // boundary shorter than the longest relation is avoided, few relations
+    // can bind to it
+    // Every try is rolled back, so it costs as much as the bind itself
+    struct LookaheadAlgorithm : DiagrammGeneratingAlgorithm
+    {
+        LookaheadAlgorithm();
+
+        void generate(const std::vector<std::vector<van_kampen::GroupElement>> &words) override;
+
+        van_kampen::Diagramm &diagramm() override;
+
+        std::size_t cellsLimit = 0;
+        std::size_t width = 4; // Relations tried on every level
+        std::size_t depth = 1; // Levels of lookahead
+        bool quiet = false;
+        std::size_t threads = 0; // Threads matching relation against large boundary, zero for all available
+
+    private:
+        // Try relations which are not added yet, cyclically from position from
+        // Returns if any of them binds, then boundary is set to the shortest
+        // length reached in given number of levels and chosen to the first
+        // relation on the way to it
+        bool search(const std::vector<std::vector<van_kampen::GroupElement>> &words,
+                    std::vector<bool> &isAdded,
+                    std::size_t from,
+                    std::size_t levels,
+                    bool forced,
+                    std::size_t &chosen,
+                    std::size_t &boundary);
+
+        van_kampen::Diagramm diagramm_;
+        std::size_t minBoundary_ = 0; // Length of the longest relation except hub
+    };
+} // namespace van_kampen
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "Generation.hpp"
+
+namespace van_kampen
+{
+    // Statistics of one portfolio generation
+    struct PortfolioRun
+    {
+        GenerationParameters parameters;
+        std::size_t cells = 0;    // Cells bound
+        std::size_t boundary = 0; // Boundary circuit length
+        std::size_t nodes = 0;
+        double seconds = 0.0;
+        bool started = false;  // Run is skipped if other one has finished first
+        bool complete = false; // All relations (or limit) were bound
+    };
+
+    struct PortfolioResult
+    {
+        std::unique_ptr<DiagrammGeneratingAlgorithm> best;
+        std::size_t bestRun = 0;
+        std::vector<PortfolioRun> runs;
+    };
+
+    // Returns if runs alternate iterative and large-first algorithms, which is
+    // done only when base flags are valid for both of them
+    bool portfolioAlternatesAlgorithms(const GenerationParameters &base);
+
+    // Parameters of run with index: run 0 uses base ones, others shuffle with seed
+    // base.seed + index; odd ones switch algorithm if portfolio alternates them,
+    // large-first runs vary number of small words per large one
+    GenerationParameters portfolioRunParameters(const GenerationParameters &base, std::size_t index);
+
+    // Generate diagram for words (hub is last) with runs concurrent generations
+    // With stopOnComplete runs are stopped once one of them binds all relations
+    // Best run has most cells bound, then shortest boundary
+    PortfolioResult runPortfolio(const std::vector<std::vector<GroupElement>> &words,
+                                 const GenerationParameters &base,
+                                 std::size_t runs,
+                                 std::size_t threads,
+                                 bool stopOnComplete);
+
+    // Print statistics table, one run per line
+    void printPortfolio(const PortfolioResult &result, std::ostream &os);
+} // namespace van_kampen
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Group.hpp"
+
+namespace van_kampen
+{
+    // Index of cyclic k-mers of relations for estimating which relations bind
+    // to each other: relation binds along inversed boundary read backwards,
+    // so k-mer x1..xk of placed relation is matched by k-mer xk^-1..x1^-1
+    // Every k-mer occurrence is matched at most once
+    class AffinityIndex
+    {
+    public:
+        // Relation id is its index in words, the last relation is hub
+        // Index is built and scores are computed in parallel
+        // K-mers are compared by 64-bit hashes
+        AffinityIndex(const std::vector<std::vector<GroupElement>> &words, std::size_t k, std::size_t threads);
+
+        // Number of k-mers of relation b matched by k-mers of relation a
+        std::size_t pairAffinity(std::size_t a, std::size_t b) const;
+
+        // Number of k-mers of every relation matched by k-mers of all other ones
+        const std::vector<std::size_t> &scores() const noexcept;
+
+        // Relations except hub in greedy chain order: starting from hub, next
+        // relation has the largest share of its k-mers matched by k-mers of
+        // hub and relations before it; ties go to relation with larger id
+        // Time is O(L log L) for total relations length L
+        std::vector<std::size_t> chainOrder() const;
+
+    private:
+        using kmer_t = std::uint64_t;
+
+        struct Kmer
+        {
+            kmer_t code;       // Hash of k-mer
+            kmer_t match;      // Hash of k-mer matching it
+            std::size_t count; // Occurrences in relation
+        };
+
+        // Count of k-mer in relation
+        std::size_t count(std::size_t relation, kmer_t code) const;
+
+        std::vector<std::vector<Kmer>> kmers_; // Distinct k-mers of every relation, sorted by code
+        std::vector<std::size_t> lengths_;     // Number of k-mers of every relation
+        std::vector<std::size_t> scores_;
+    };
+
+    // Reorder relations except hub by greedy chain from hub, so that the first
+    // relations tried by iterative algorithm are the ones likely to bind
+    // Relations without matching k-mers keep their order
+    void orderByAffinity(std::vector<std::vector<GroupElement>> &words, std::size_t k, std::size_t threads);
+} // namespace van_kampen
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <functional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Group.hpp"
+#include "VanKampenUtils.hpp"
+
+namespace van_kampen
+{
+    // Order of relation retries
+    // Relation which failed to bind sleeps until boundary changes near letters
+    // it may match. Relations are indexed by their cyclic 2-grams and squares
+    // by their letters too, so a bind only wakes relations sharing a 2-gram (a
+    // letter for squares) with the exposed boundary segment
+    // Awake relations are returned in passes by increasing id
+    class RelationScheduler
+    {
+    public:
+        // Relation id is its index in words, words must outlive scheduler
+        // All relations are awake
+        explicit RelationScheduler(const std::vector<std::vector<GroupElement>> &words);
+
+        // Wake relations which may match segment
+        void expose(const std::vector<GroupElement> &segment);
+
+        // Relation is bound and will never be returned again
+        void bound(std::size_t id);
+
+        // Relation failed to bind and sleeps until woken
+        void failed(std::size_t id);
+
+        // Wake all relations which are not bound
+        void wakeAll();
+
+        // Put all relations to sleep
+        void sleepAll();
+
+        // Returns next awake relation after last returned one, passes are
+        // wrapped around; returns false if all relations sleep
+        bool next(std::size_t &id);
+
+    private:
+        using key_t = std::string;
+
+        static key_t letterKey(const GroupElement &letter);
+        static key_t pairKey(const GroupElement &first, const GroupElement &second);
+
+        const std::vector<std::vector<GroupElement>> &words_;
+        std::unordered_map<key_t, std::vector<std::size_t>> bySquareLetter_, byPair_;
+        std::vector<char> isBound_;
+        std::set<std::size_t> awake_;
+        std::size_t cursor_ = 0;
+    };
+
+    // Bind awake relations of scheduler to diagramm until all of them sleep,
+    // then pass over all relations again; a pass is forced only after full
+    // unforced one binds nothing, and every forced bind is followed by
+    // unforced retries of relations it has woken
+    // onBound is called after every bind
+    // Returns number of bound relations
+    std::size_t bindScheduled(Diagramm &diagramm,
+                              const std::vector<std::vector<GroupElement>> &words,
+                              RelationScheduler &scheduler,
+                              std::size_t limit,
+                              const std::function<void()> &onBound,
+                              const std::function<bool()> &stopped);
+} // namespace van_kampen
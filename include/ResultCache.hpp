@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "Group.hpp"
+
+namespace van_kampen
+{
+    // On-disk cache of generated diagrams
+    // Entries are keyed by relations and generation parameters, files are
+    // named by hash of key and keep key itself to tell collisions apart
+    // Safe to share between concurrent processes
+    class ResultCache
+    {
+    public:
+        // Cache in directory, which will not grow over maxBytes
+        ResultCache(const std::filesystem::path &directory, std::uintmax_t maxBytes);
+
+        // Returns key of generation of words with parameters, it is as long as words
+        // Parameters string must describe all flags which affect generation
+        static std::string makeKey(const std::vector<std::vector<GroupElement>> &words,
+                                   const std::string &parameters);
+
+        // Load entry to diagramm based on empty graph
+        // Returns if entry was found
+        bool load(const std::string &key, Diagramm &diagramm) const;
+
+        // Store generated diagramm by key, evict old entries if needed
+        void store(const std::string &key, const Diagramm &diagramm);
+
+    private:
+        // Remove least recently used entries until cache fits in maxBytes_
+        void evict();
+
+        std::filesystem::path entryPath(const std::string &key) const;
+
+        std::filesystem::path directory_;
+        std::uintmax_t maxBytes_;
+    };
+} // namespace van_kampen
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "DiagramGeneratingAlgorithm.hpp"
+
+namespace van_kampen
+{
+    // Hub boundary is cut into segments, cells are grown on every segment
+    // in parallel in separate graphs, which are stitched into one diagram
+    // in parallel with ConcurrentGraphBuilder
+    // Relations are assigned to segments by 2-grams they can glue along,
+    // relations which did not bind on their segment are bound serially
+    // after stitching
+    struct ShardedAlgorithm : DiagrammGeneratingAlgorithm
+    {
+        ShardedAlgorithm();
+
+        void generate(const std::vector<std::vector<van_kampen::GroupElement>> &words) override;
+
+        van_kampen::Diagramm &diagramm() override;
+
+        std::size_t cellsLimit = 0;
+        std::size_t shards = 0;  // Number of hub segments, threads count if zero
+        std::size_t threads = 0; // Zero for all available
+        bool quiet = false;
+
+    private:
+        van_kampen::Diagramm diagramm_;
+    };
+} // namespace van_kampen
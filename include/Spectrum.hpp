@@ -0,0 +1,44 @@
+#pragma once
+
+#include <ostream>
+#include <vector>
+
+#include "Graph.hpp"
+
+namespace van_kampen
+{
+    struct SpectrumParameters
+    {
+        std::size_t threads = 1;              // Number of worker threads
+        std::size_t extremeCount = 10;        // Number of smallest and largest eigenvalues to find
+        std::size_t lanczosSteps = 100;       // Krylov subspace dimension of histogram runs
+        std::size_t extremeSteps = 500;       // Krylov subspace dimension limit of extreme eigenvalue runs
+        std::size_t probes = 4;               // Random start vectors used for histogram
+        std::size_t bins = 100;               // Histogram bins count
+        unsigned seed = 1;                    // Seed of random start vectors
+        double tolerance = 1e-6;              // Ritz values with larger relative residual bound are not reported
+        std::size_t solverIterations = 10000; // Conjugate gradient iterations limit of every inverse step
+    };
+
+    struct SpectrumReport
+    {
+        std::size_t nodes = 0;
+        std::vector<double> smallest, largest;                   // Extreme eigenvalue estimates, ascending
+        std::vector<double> smallestResiduals, largestResiduals; // Bounds of their relative errors
+        double histogramBegin = 0.0, binWidth = 0.0;
+        std::vector<double> histogram; // Estimated number of eigenvalues in every bin
+    };
+
+    // Estimate spectrum of graph Laplacian with Lanczos method on sparse matrix
+    // Largest eigenvalues are Ritz values of fully reorthogonalized run,
+    // which stops when they converge;
+    // smallest ones are zeros of connected components and inverses of Ritz
+    // values of L^-1 on kernel complement, solved by conjugate gradient
+    // Only converged Ritz values are reported, so there may be fewer than
+    // requested; multiple eigenvalues are found once
+    // Histogram is built by stochastic Lanczos quadrature
+    SpectrumReport analyzeSpectrum(const Graph &graph, const SpectrumParameters &parameters);
+
+    // Print report as gnuplot data blocks: smallest, largest eigenvalues and histogram
+    void printSpectrum(const SpectrumReport &report, std::ostream &os);
+} // namespace van_kampen
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "DiagramGeneratingAlgorithm.hpp"
+
+namespace van_kampen
+{
+    struct GenerationProgress
+    {
+        std::size_t bound = 0;    // Relations bound by algorithm, merges for merging one
+        std::size_t cells = 0;    // Cells in diagram, merging one has them when finished
+        std::size_t boundary = 0; // Length of boundary circuit
+        bool finished = false;
+    };
+
+    // Generation advanced by steps from caller's thread
+    // Algorithm runs in its own thread, but only while step waits for it,
+    // so diagram may be read, copied or written between steps
+    // Algorithm is suspended after cells are bound, stop flag of algorithm is
+    // replaced by cancellation flag
+    class SteppedGeneration
+    {
+    public:
+        SteppedGeneration(std::unique_ptr<DiagrammGeneratingAlgorithm> algorithm,
+                          std::vector<std::vector<GroupElement>> words);
+
+        // Cancels generation if it is not finished
+        ~SteppedGeneration();
+
+        SteppedGeneration(const SteppedGeneration &) = delete;
+        SteppedGeneration &operator=(const SteppedGeneration &) = delete;
+
+        // Continue generation until at least budget more relations are bound
+        // or it finishes, rethrows exception thrown by algorithm
+        GenerationProgress step(std::size_t budget = 1);
+
+        // Stop generation at next check of algorithm and wait for it,
+        // diagram keeps cells bound so far
+        void cancel();
+
+        bool finished() const;
+        GenerationProgress progress();
+
+        DiagrammGeneratingAlgorithm &algorithm() noexcept;
+
+        // Take algorithm with its diagram, generation must be finished
+        std::unique_ptr<DiagrammGeneratingAlgorithm> release();
+
+    private:
+        // Let algorithm run until it spends budget or finishes
+        void resume(std::size_t budget);
+
+        // Called in algorithm thread
+        void suspend(std::size_t count);
+
+        std::unique_ptr<DiagrammGeneratingAlgorithm> algorithm_;
+        std::vector<std::vector<GroupElement>> words_;
+        std::atomic_bool cancelled_{false};
+
+        // Guard everything below, algorithm runs only while running_ is set
+        mutable std::mutex mutex_;
+        std::condition_variable wake_;
+        std::size_t budget_ = 0;
+        std::size_t bound_ = 0;
+        bool running_ = false;
+        bool finished_ = false;
+        std::exception_ptr error_;
+
+        std::thread worker_;
+    };
+} // namespace van_kampen
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <ostream>
+
+#include "Graph.hpp"
+
+namespace van_kampen
+{
+    // Draw graph as svg image using node positions
+    // Image is streamed through fixed size buffer
+    void printSvg(const Graph &graph, std::ostream &os);
+} // namespace van_kampen
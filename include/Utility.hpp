@@ -1,5 +1,16 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
 namespace van_kampen
 {
     namespace utility
@@ -12,5 +23,88 @@ namespace van_kampen
             os.flush();
         }
 
+        // Write trivially copyable value to ostream as is
+        template <typename T>
+        void writeRaw(std::ostream &os, const T &value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "value must be trivially copyable");
+            os.write(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+
+        // Write string to ostream prefixed with its length
+        inline void writeRaw(std::ostream &os, const std::string &value)
+        {
+            writeRaw(os, static_cast<std::uint32_t>(value.size()));
+            os.write(value.data(), value.size());
+        }
+
+        // Read value written by writeRaw
+        // Throws if stream has ended
+        template <typename T>
+        T readRaw(std::istream &is)
+        {
+            T value;
+            if constexpr (std::is_same_v<T, std::string>)
+            {
+                value.resize(readRaw<std::uint32_t>(is));
+                is.read(value.data(), value.size());
+            }
+            else
+            {
+                static_assert(std::is_trivially_copyable_v<T>, "value must be trivially copyable");
+                is.read(reinterpret_cast<char *>(&value), sizeof(T));
+            }
+            if (!is)
+            {
+                throw std::runtime_error("unexpected end of binary data");
+            }
+            return value;
+        }
+
+        // Returns number of threads to use when requested is zero
+        inline std::size_t defaultThreadsCount()
+        {
+            return std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        // Split range [0, size) into equal chunks and call body(begin, end, chunkId)
+        // for each chunk in its own thread
+        // Rethrows first exception thrown by body
+        template <typename F>
+        void parallelFor(std::size_t size, std::size_t threads, F &&body)
+        {
+            threads = std::max<std::size_t>(1, std::min(threads, size));
+            if (threads == 1)
+            {
+                body(std::size_t{0}, size, std::size_t{0});
+                return;
+            }
+            std::vector<std::thread> workers;
+            std::vector<std::exception_ptr> errors(threads);
+            for (std::size_t t = 0; t < threads; ++t)
+            {
+                workers.emplace_back([&, t]() {
+                    try
+                    {
+                        body(size * t / threads, size * (t + 1) / threads, t);
+                    }
+                    catch (...)
+                    {
+                        errors[t] = std::current_exception();
+                    }
+                });
+            }
+            for (std::thread &worker : workers)
+            {
+                worker.join();
+            }
+            for (const std::exception_ptr &error : errors)
+            {
+                if (error)
+                {
+                    std::rethrow_exception(error);
+                }
+            }
+        }
     } // namespace utility
 } // namespace van_kampen
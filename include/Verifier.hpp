@@ -0,0 +1,39 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Group.hpp"
+
+namespace van_kampen
+{
+    struct VerifyParameters
+    {
+        std::size_t threads = 1;        // Number of worker threads
+        std::size_t maxViolations = 10; // Number of first violations to report
+        std::string circuit;            // Expected boundary label, not checked if empty
+    };
+
+    struct VerifyReport
+    {
+        std::size_t nodes = 0, edges = 0, faces = 0, cells = 0;
+        std::size_t violationsCount = 0;
+        std::vector<std::string> violations; // First violations in order of nodes and faces
+
+        bool ok() const noexcept { return violationsCount == 0; }
+    };
+
+    // Check that diagram is valid:
+    // - every transition has reversed one with inversed label
+    // - boundary circuit is closed walk from terminal with expected label
+    // - every inner face is a cyclic shift of relation or of its inverse,
+    //   inner faces are as many as cells and Euler formula holds
+    // Nodes and faces are checked in parallel, time is linear in diagram size
+    VerifyReport verifyDiagram(const Graph &graph,
+                               Diagramm &diagramm,
+                               const std::vector<std::vector<GroupElement>> &words,
+                               const VerifyParameters &parameters);
+
+    void printVerifyReport(const VerifyReport &report, std::ostream &os);
+} // namespace van_kampen
@@ -0,0 +1,74 @@
+/* C interface of vankampen-core library */
+#ifndef VANKAMPEN_H
+#define VANKAMPEN_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /* Generated or loaded diagram */
+    typedef struct vk_diagram vk_diagram;
+
+    typedef enum
+    {
+        VK_ALGORITHM_ITERATIVE = 0,
+        VK_ALGORITHM_LARGE_FIRST = 1,
+        VK_ALGORITHM_MERGING = 2,
+        VK_ALGORITHM_SHARDED = 3, /* hub segments in parallel, one per thread */
+    } vk_algorithm;
+
+    typedef enum
+    {
+        VK_FORMAT_DOT = 0,
+        VK_FORMAT_EDGES = 1,
+        VK_FORMAT_SVG = 2,    /* node positions are computed if needed */
+        VK_FORMAT_BINARY = 3, /* can be loaded back with vk_load */
+    } vk_format;
+
+    /* Fields are only appended in later versions, library reads struct_size
+       bytes and takes defaults for the rest */
+    typedef struct
+    {
+        size_t struct_size; /* sizeof(vk_options) of caller, set by vk_options_init */
+        vk_algorithm algorithm;
+        size_t cells_limit; /* zero for no limit */
+        size_t per_large;   /* small words used to build one big one, large-first only */
+        int shuffle;        /* shuffle relations before generation */
+        int sort;           /* sort relations by length before generation */
+    } vk_options;
+
+    /* Fill options with defaults of vankamp-vis tool and set struct_size */
+    void vk_options_init(vk_options *options);
+
+    /* All functions below return zero on success and nonzero on failure,
+       failure description is returned by vk_last_error */
+
+    /* Generate diagram from group representation text of given length */
+    int vk_generate(const char *representation, size_t length, const vk_options *options, vk_diagram **result);
+
+    /* Load diagram serialized with VK_FORMAT_BINARY */
+    int vk_load(const char *data, size_t length, vk_diagram **result);
+
+    /* Serialize diagram to new buffer, which must be released with vk_free_buffer */
+    int vk_serialize(vk_diagram *diagram, vk_format format, char **buffer, size_t *length);
+
+    /* Write boundary circuit label to new buffer, which must be released with vk_free_buffer */
+    int vk_circuit(vk_diagram *diagram, char **buffer, size_t *length);
+
+    /* Returns number of cells in diagram */
+    size_t vk_cells_count(const vk_diagram *diagram);
+
+    void vk_free_buffer(char *buffer);
+    void vk_diagram_free(vk_diagram *diagram);
+
+    /* Returns description of last failure in calling thread */
+    const char *vk_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VANKAMPEN_H */
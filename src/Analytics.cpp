@@ -0,0 +1,426 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+
+#include "Analytics.hpp"
+#include "CsrGraph.hpp"
+#include "Utility.hpp"
+
+namespace van_kampen
+{
+namespace
+{
+using distance_t = std::uint32_t;
+const distance_t unreached = std::numeric_limits<distance_t>::max();
+
+// Levels with less work than this are walked by one thread
+const std::size_t parallelGrain = 1 << 14;
+
+// Direction switching thresholds of Beamer et al.: go bottom-up when edges
+// of frontier exceed unexplored edges / alpha, back when frontier gets
+// smaller than nodes / beta
+const std::size_t alpha = 14, beta = 24;
+
+// Breadth first search which walks large levels bottom-up: every node not
+// reached yet looks for its neighbour in frontier, instead of frontier
+// nodes looking through all their neighbours
+class Bfs
+{
+public:
+    Bfs(const CsrGraph &graph, std::size_t threads)
+        : graph_(graph), threads_(threads), visited_(new std::atomic<char>[graph.size()]),
+          distances_(graph.size()), inFrontier_(graph.size()), inNext_(graph.size())
+    {
+    }
+
+    // Find distances from source, returns eccentricity of source
+    std::size_t run(nodeId_t source)
+    {
+        const std::size_t size = graph_.size();
+        std::fill(distances_.begin(), distances_.end(), unreached);
+        for (std::size_t v = 0; v < size; ++v)
+        {
+            visited_[v].store(false, std::memory_order_relaxed);
+        }
+        visited_[source].store(true, std::memory_order_relaxed);
+        distances_[source] = 0;
+        frontier_.assign(1, source);
+        std::size_t frontierSize = 1, frontierEdges = graph_.degree(source);
+        std::size_t unexplored = graph_.adjacent.size() - frontierEdges;
+        bool bottomUp = false;
+        distance_t level = 0;
+        while (frontierSize)
+        {
+            if (!bottomUp && frontierEdges > unexplored / alpha)
+            {
+                bottomUp = true;
+                std::fill(inFrontier_.begin(), inFrontier_.end(), false);
+                for (nodeId_t v : frontier_)
+                {
+                    inFrontier_[v] = true;
+                }
+            }
+            else if (bottomUp && frontierSize < size / beta)
+            {
+                bottomUp = false;
+                frontier_.clear();
+                for (std::size_t v = 0; v < size; ++v)
+                {
+                    if (inFrontier_[v])
+                    {
+                        frontier_.push_back(v);
+                    }
+                }
+            }
+            std::tie(frontierSize, frontierEdges) = bottomUp ? stepBottomUp(level) : stepTopDown(level, frontierEdges);
+            unexplored -= std::min(unexplored, frontierEdges);
+            if (frontierSize)
+            {
+                ++level;
+            }
+        }
+        return level;
+    }
+
+    const std::vector<distance_t> &distances() const noexcept { return distances_; }
+
+private:
+    std::size_t threadsFor(std::size_t work) const noexcept { return work < parallelGrain ? 1 : threads_; }
+
+    // Returns size and edges count of next frontier
+    std::pair<std::size_t, std::size_t> stepTopDown(distance_t level, std::size_t frontierEdges)
+    {
+        std::size_t threads = std::min(threadsFor(frontierEdges), frontier_.size());
+        std::vector<std::vector<nodeId_t>> parts(std::max<std::size_t>(1, threads));
+        utility::parallelFor(frontier_.size(), threads, [&](std::size_t begin, std::size_t end, std::size_t part) {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                nodeId_t v = frontier_[i];
+                for (std::size_t e = graph_.offsets[v]; e < graph_.offsets[v + 1]; ++e)
+                {
+                    nodeId_t u = graph_.adjacent[e];
+                    if (!visited_[u].load(std::memory_order_relaxed) && !visited_[u].exchange(true, std::memory_order_relaxed))
+                    {
+                        distances_[u] = level + 1;
+                        parts[part].push_back(u);
+                    }
+                }
+            }
+        });
+        frontier_.clear();
+        std::size_t edges = 0;
+        for (const auto &part : parts)
+        {
+            for (nodeId_t v : part)
+            {
+                edges += graph_.degree(v);
+            }
+            frontier_.insert(frontier_.end(), part.begin(), part.end());
+        }
+        return {frontier_.size(), edges};
+    }
+
+    std::pair<std::size_t, std::size_t> stepBottomUp(distance_t level)
+    {
+        std::size_t threads = threadsFor(graph_.adjacent.size());
+        std::vector<std::pair<std::size_t, std::size_t>> counts(std::max<std::size_t>(1, threads));
+        utility::parallelFor(graph_.size(), threads, [&](std::size_t begin, std::size_t end, std::size_t part) {
+            for (std::size_t v = begin; v < end; ++v)
+            {
+                inNext_[v] = false;
+                if (visited_[v].load(std::memory_order_relaxed))
+                {
+                    continue;
+                }
+                for (std::size_t e = graph_.offsets[v]; e < graph_.offsets[v + 1]; ++e)
+                {
+                    if (inFrontier_[graph_.adjacent[e]])
+                    {
+                        visited_[v].store(true, std::memory_order_relaxed);
+                        distances_[v] = level + 1;
+                        inNext_[v] = true;
+                        ++counts[part].first;
+                        counts[part].second += graph_.degree(v);
+                        break;
+                    }
+                }
+            }
+        });
+        inFrontier_.swap(inNext_);
+        std::pair<std::size_t, std::size_t> total{0, 0};
+        for (const auto &count : counts)
+        {
+            total.first += count.first;
+            total.second += count.second;
+        }
+        return total;
+    }
+
+    const CsrGraph &graph_;
+    std::size_t threads_;
+    std::unique_ptr<std::atomic<char>[]> visited_;
+    std::vector<distance_t> distances_;
+    std::vector<nodeId_t> frontier_;          // Frontier of top-down steps
+    std::vector<char> inFrontier_, inNext_;   // Frontier of bottom-up steps
+};
+
+// Eccentricities of sources by bit-parallel BFS: 64 sources share one walk,
+// bit i of node mask is set when it is reached from source i
+// Batches of sources are walked in parallel
+std::vector<std::size_t> eccentricities(const CsrGraph &graph, const std::vector<nodeId_t> &sources, std::size_t threads)
+{
+    using mask_t = std::uint64_t;
+    const std::size_t width = 64;
+    std::vector<std::size_t> result(sources.size(), 0);
+    std::size_t batches = (sources.size() + width - 1) / width;
+    utility::parallelFor(batches, threads, [&](std::size_t begin, std::size_t end, std::size_t) {
+        std::vector<mask_t> seen(graph.size()), visit(graph.size()), next(graph.size());
+        std::vector<nodeId_t> frontier, following;
+        for (std::size_t batch = begin; batch < end; ++batch)
+        {
+            std::fill(seen.begin(), seen.end(), 0);
+            frontier.clear();
+            std::size_t first = batch * width, count = std::min(width, sources.size() - first);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                nodeId_t v = sources[first + i];
+                if (!visit[v])
+                {
+                    frontier.push_back(v);
+                }
+                visit[v] |= mask_t{1} << i;
+                seen[v] |= mask_t{1} << i;
+            }
+            for (std::size_t level = 1; !frontier.empty(); ++level)
+            {
+                following.clear();
+                for (nodeId_t v : frontier)
+                {
+                    for (std::size_t e = graph.offsets[v]; e < graph.offsets[v + 1]; ++e)
+                    {
+                        nodeId_t u = graph.adjacent[e];
+                        mask_t reached = visit[v] & ~seen[u];
+                        if (reached)
+                        {
+                            if (!next[u])
+                            {
+                                following.push_back(u);
+                            }
+                            next[u] |= reached;
+                        }
+                    }
+                }
+                mask_t reachedAny = 0;
+                for (nodeId_t v : frontier)
+                {
+                    visit[v] = 0;
+                }
+                for (nodeId_t u : following)
+                {
+                    seen[u] |= next[u];
+                    reachedAny |= next[u];
+                    visit[u] = next[u];
+                    next[u] = 0;
+                }
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    if (reachedAny >> i & 1)
+                    {
+                        result[first + i] = level;
+                    }
+                }
+                frontier.swap(following);
+            }
+        }
+    });
+    return result;
+}
+
+// Number of edges of boundary circuit from terminal
+std::size_t boundaryLength(const Graph &graph, nodeId_t terminal, std::size_t edges)
+{
+    std::size_t length = 0;
+    nodeId_t v = terminal;
+    do
+    {
+        if (graph.nodes()[v].transitions().empty() || length > 2 * edges)
+        {
+            throw std::invalid_argument("diagram is not looped");
+        }
+        v = graph.nodes()[v].transitions().back().to;
+        ++length;
+    } while (v != terminal);
+    return length;
+}
+} // namespace
+
+AnalyticsReport analyzeDiagram(const Graph &graph, const Diagramm &diagramm, const AnalyticsParameters &parameters)
+{
+    AnalyticsReport report;
+    CsrGraph csr(graph);
+    const std::size_t size = csr.size();
+    for (std::size_t v = 0; v < size; ++v)
+    {
+        if (graph.isRemoved(v))
+        {
+            continue;
+        }
+        // Loops are not in adjacency, degree counts them twice
+        std::size_t degree = graph.nodes()[v].transitions().size();
+        if (report.degrees.size() <= degree)
+        {
+            report.degrees.resize(degree + 1, 0);
+        }
+        ++report.degrees[degree];
+        ++report.nodes;
+        report.edges += degree;
+    }
+    report.edges /= 2;
+    report.cells = diagramm.cellsCount();
+    nodeId_t terminal = diagramm.getTerminal();
+    if (Node::isNonexistantNode(terminal) || graph.isRemoved(terminal))
+    {
+        return report;
+    }
+    report.boundaryLength = boundaryLength(graph, terminal, report.edges);
+
+    Bfs bfs(csr, parameters.threads);
+    std::size_t depth = bfs.run(terminal);
+    std::vector<nodeId_t> component;
+    std::vector<distance_t> labels(bfs.distances());
+    report.terminalDistance.assign(depth + 1, 0);
+    double distanceSum = 0.0;
+    for (std::size_t v = 0; v < size; ++v)
+    {
+        if (labels[v] != unreached)
+        {
+            component.push_back(v);
+            ++report.terminalDistance[labels[v]];
+            distanceSum += labels[v];
+        }
+    }
+    report.meanTerminalDistance = distanceSum / static_cast<double>(component.size());
+
+    // Other components are walked by sequential steps, diagram usually has one
+    report.components = 1;
+    for (std::size_t v = 0; v < size; ++v)
+    {
+        if (labels[v] == unreached && !graph.isRemoved(v))
+        {
+            ++report.components;
+            std::vector<nodeId_t> queue = {static_cast<nodeId_t>(v)};
+            labels[v] = 0;
+            for (std::size_t head = 0; head < queue.size(); ++head)
+            {
+                for (std::size_t e = csr.offsets[queue[head]]; e < csr.offsets[queue[head] + 1]; ++e)
+                {
+                    if (labels[csr.adjacent[e]] == unreached)
+                    {
+                        labels[csr.adjacent[e]] = 0;
+                        queue.push_back(csr.adjacent[e]);
+                    }
+                }
+            }
+        }
+    }
+
+    if (component.size() <= parameters.exactLimit || !parameters.samples || parameters.samples >= component.size())
+    {
+        std::vector<std::size_t> result = eccentricities(csr, component, parameters.threads);
+        report.exact = true;
+        report.sources = component.size();
+        report.diameter = report.diameterUpperBound = *std::max_element(result.begin(), result.end());
+        report.radius = report.radiusLowerBound = *std::min_element(result.begin(), result.end());
+        return report;
+    }
+
+    // Every BFS gives eccentricity of its source, lower bound of eccentricity
+    // of every node and its distance to the nearest source
+    report.exact = false;
+    std::vector<distance_t> lower(size, 0), nearest(size, unreached);
+    std::vector<char> isSource(size, false);
+    report.diameter = 0;
+    report.radius = std::numeric_limits<std::size_t>::max();
+    nodeId_t source = terminal;
+    for (std::size_t sample = 0; sample < parameters.samples; ++sample)
+    {
+        isSource[source] = true;
+        ++report.sources;
+        std::size_t eccentricity = sample ? bfs.run(source) : depth;
+        report.diameter = std::max(report.diameter, eccentricity);
+        report.radius = std::min(report.radius, eccentricity);
+        const auto &distances = bfs.distances();
+        utility::parallelFor(component.size(), parameters.threads, [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                nodeId_t v = component[i];
+                lower[v] = std::max(lower[v], distances[v]);
+                nearest[v] = std::min(nearest[v], distances[v]);
+            }
+        });
+        report.radiusLowerBound = lower[*std::min_element(component.begin(), component.end(), [&](nodeId_t a, nodeId_t b) {
+            return lower[a] < lower[b];
+        })];
+        report.diameterUpperBound = 2 * report.radius;
+        if (report.diameter == report.diameterUpperBound && report.radius == report.radiusLowerBound)
+        {
+            report.exact = true;
+            break;
+        }
+        // Farthest nodes lie near periphery, ones with least lower bound near center
+        source = Node::makeNonexistantNode();
+        for (nodeId_t v : component)
+        {
+            if (isSource[v])
+            {
+                continue;
+            }
+            if (Node::isNonexistantNode(source) ||
+                (sample % 2 == 0 ? nearest[v] > nearest[source] : lower[v] < lower[source]))
+            {
+                source = v;
+            }
+        }
+        if (Node::isNonexistantNode(source))
+        {
+            break;
+        }
+    }
+    return report;
+}
+
+void printAnalytics(const AnalyticsReport &report, std::ostream &os)
+{
+    auto printArray = [&](const std::vector<std::size_t> &values) {
+        os << '[';
+        for (std::size_t i = 0; i < values.size(); ++i)
+        {
+            os << (i ? ", " : "") << values[i];
+        }
+        os << ']';
+    };
+    os << "{\n"
+       << "  \"nodes\": " << report.nodes << ",\n"
+       << "  \"edges\": " << report.edges << ",\n"
+       << "  \"cells\": " << report.cells << ",\n"
+       << "  \"components\": " << report.components << ",\n"
+       << "  \"boundaryLength\": " << report.boundaryLength << ",\n"
+       << "  \"degrees\": ";
+    printArray(report.degrees);
+    os << ",\n  \"terminalDistance\": {\"histogram\": ";
+    printArray(report.terminalDistance);
+    os << ", \"max\": " << (report.terminalDistance.empty() ? 0 : report.terminalDistance.size() - 1)
+       << ", \"mean\": " << report.meanTerminalDistance << "},\n"
+       << "  \"eccentricity\": {\"exact\": " << (report.exact ? "true" : "false")
+       << ", \"sources\": " << report.sources
+       << ", \"diameter\": " << report.diameter
+       << ", \"diameterUpperBound\": " << report.diameterUpperBound
+       << ", \"radius\": " << report.radius
+       << ", \"radiusLowerBound\": " << report.radiusLowerBound << "}\n"
+       << "}" << std::endl;
+}
+} // namespace van_kampen
@@ -0,0 +1,206 @@
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include "vankampen.h"
+
+#include "Generation.hpp"
+#include "GroupRepresentationParser.hpp"
+#include "Layout.hpp"
+
+struct vk_diagram
+{
+    std::shared_ptr<van_kampen::Graph> graph;
+    van_kampen::Diagramm diagramm;
+};
+
+namespace
+{
+thread_local std::string lastError;
+
+// Run body, convert exceptions to error code and last error
+template <typename Body>
+int guarded(Body body)
+{
+    try
+    {
+        body();
+        lastError.clear();
+        return 0;
+    }
+    catch (const std::exception &e)
+    {
+        lastError = e.what();
+    }
+    catch (...)
+    {
+        lastError = "unknown error";
+    }
+    return 1;
+}
+
+// Copy text to buffer allocated with malloc
+void toBuffer(const std::string &text, char **buffer, std::size_t *length)
+{
+    if (buffer == nullptr || length == nullptr)
+    {
+        throw std::invalid_argument("buffer and length must not be null");
+    }
+    *buffer = static_cast<char *>(std::malloc(text.size() + 1));
+    if (*buffer == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    std::memcpy(*buffer, text.c_str(), text.size() + 1);
+    *length = text.size();
+}
+
+// Size of the first version of options, later ones only append fields
+const std::size_t firstOptionsSize = sizeof(vk_options);
+
+void checkDiagram(const vk_diagram *diagram)
+{
+    if (diagram == nullptr)
+    {
+        throw std::invalid_argument("diagram must not be null");
+    }
+}
+} // namespace
+
+extern "C"
+{
+    void vk_options_init(vk_options *options)
+    {
+        van_kampen::GenerationParameters defaults;
+        options->struct_size = sizeof(vk_options);
+        options->algorithm = VK_ALGORITHM_ITERATIVE;
+        options->cells_limit = defaults.cellsLimit;
+        options->per_large = defaults.perLarge;
+        options->shuffle = defaults.shuffle;
+        options->sort = defaults.sort;
+    }
+
+    int vk_generate(const char *representation, size_t length, const vk_options *options, vk_diagram **result)
+    {
+        return guarded([&] {
+            if (representation == nullptr || result == nullptr)
+            {
+                throw std::invalid_argument("representation and result must not be null");
+            }
+            vk_options defaults;
+            vk_options_init(&defaults);
+            vk_options chosen = defaults;
+            if (options != nullptr)
+            {
+                if (options->struct_size < firstOptionsSize || options->struct_size > sizeof(vk_options))
+                {
+                    throw std::invalid_argument("options struct_size is not set by vk_options_init or is unsupported");
+                }
+                std::memcpy(&chosen, options, options->struct_size);
+            }
+
+            van_kampen::GenerationParameters parameters;
+            switch (chosen.algorithm)
+            {
+            case VK_ALGORITHM_ITERATIVE:
+                parameters.algorithm = van_kampen::algorithmType::ITERATIVE;
+                break;
+            case VK_ALGORITHM_LARGE_FIRST:
+                parameters.algorithm = van_kampen::algorithmType::LARGE_FIRST;
+                break;
+            case VK_ALGORITHM_MERGING:
+                parameters.algorithm = van_kampen::algorithmType::MERGING;
+                break;
+            case VK_ALGORITHM_SHARDED:
+                parameters.algorithm = van_kampen::algorithmType::SHARDED;
+                break;
+            default:
+                throw std::invalid_argument("unknown algorithm");
+            }
+            parameters.cellsLimit = chosen.cells_limit;
+            parameters.perLarge = chosen.per_large;
+            parameters.shuffle = chosen.shuffle != 0;
+            parameters.sort = chosen.sort != 0;
+            parameters.quiet = true;
+
+            auto words = van_kampen::GroupRepresentationParser::parse(std::string(representation, length));
+            van_kampen::prepareWords(words, parameters);
+            auto algo = van_kampen::makeAlgorithm(parameters);
+            algo->generate(words);
+            *result = new vk_diagram{algo->sharedGraph(), algo->diagramm()};
+        });
+    }
+
+    int vk_load(const char *data, size_t length, vk_diagram **result)
+    {
+        return guarded([&] {
+            if (data == nullptr || result == nullptr)
+            {
+                throw std::invalid_argument("data and result must not be null");
+            }
+            auto graph = std::make_shared<van_kampen::Graph>();
+            auto diagram = std::make_unique<vk_diagram>(vk_diagram{graph, van_kampen::Diagramm(graph)});
+            std::istringstream is(std::string(data, length));
+            diagram->diagramm.readBinary(is);
+            *result = diagram.release();
+        });
+    }
+
+    int vk_serialize(vk_diagram *diagram, vk_format format, char **buffer, size_t *length)
+    {
+        return guarded([&] {
+            checkDiagram(diagram);
+            std::ostringstream os;
+            switch (format)
+            {
+            case VK_FORMAT_DOT:
+                diagram->graph->printSelf(os, van_kampen::graphOutputFormat::DOT);
+                break;
+            case VK_FORMAT_EDGES:
+                diagram->graph->printSelf(os, van_kampen::graphOutputFormat::TXT_EDGES);
+                break;
+            case VK_FORMAT_SVG:
+                if (!diagram->graph->isPositioned())
+                {
+                    van_kampen::computeLayout(*diagram->graph, diagram->diagramm.getCircuit(), van_kampen::LayoutParameters());
+                }
+                diagram->graph->printSelf(os, van_kampen::graphOutputFormat::SVG);
+                break;
+            case VK_FORMAT_BINARY:
+                diagram->diagramm.writeBinary(os);
+                break;
+            default:
+                throw std::invalid_argument("unknown format");
+            }
+            toBuffer(os.str(), buffer, length);
+        });
+    }
+
+    int vk_circuit(vk_diagram *diagram, char **buffer, size_t *length)
+    {
+        return guarded([&] {
+            checkDiagram(diagram);
+            toBuffer(van_kampen::circuitToString(diagram->diagramm.getCircuit()), buffer, length);
+        });
+    }
+
+    size_t vk_cells_count(const vk_diagram *diagram)
+    {
+        return diagram == nullptr ? 0 : diagram->diagramm.cellsCount();
+    }
+
+    void vk_free_buffer(char *buffer)
+    {
+        std::free(buffer);
+    }
+
+    void vk_diagram_free(vk_diagram *diagram)
+    {
+        delete diagram;
+    }
+
+    const char *vk_last_error(void)
+    {
+        return lastError.c_str();
+    }
+}
@@ -0,0 +1,151 @@
+#include <algorithm>
+
+#include "Compaction.hpp"
+
+namespace van_kampen
+{
+namespace
+{
+// Pseudo-peripheral node search stops after this many walks
+const std::size_t peripheralWalks = 8;
+
+// Distinct neighbours of nodes which are not removed, in rotation order
+struct Adjacency
+{
+    std::size_t degree(nodeId_t v) const { return offsets[v + 1] - offsets[v]; }
+
+    std::vector<std::size_t> offsets = {0}; // Node v neighbours are adjacent[offsets[v]..offsets[v + 1])
+    std::vector<nodeId_t> adjacent;
+};
+
+Adjacency makeAdjacency(const Graph &graph)
+{
+    const auto &nodes = graph.nodes();
+    auto exists = [&](nodeId_t v) {
+        return v >= 0 && static_cast<std::size_t>(v) < nodes.size() && !graph.isRemoved(v);
+    };
+    Adjacency adjacency;
+    std::vector<nodeId_t> seenFrom(nodes.size(), Node::makeNonexistantNode());
+    for (std::size_t v = 0; v < nodes.size(); ++v)
+    {
+        if (!graph.isRemoved(v))
+        {
+            for (const Transition &tr : nodes[v].transitions())
+            {
+                if (exists(tr.to) && tr.to != static_cast<nodeId_t>(v) && seenFrom[tr.to] != static_cast<nodeId_t>(v))
+                {
+                    seenFrom[tr.to] = v;
+                    adjacency.adjacent.push_back(tr.to);
+                }
+            }
+        }
+        adjacency.offsets.push_back(adjacency.adjacent.size());
+    }
+    return adjacency;
+}
+
+// Breadth first walk from root over nodes which are not visited yet, they
+// are appended to order; neighbours of every node go by increasing degree
+// if byDegree is set
+// Returns number of levels, lastLevel is set to position of its first node
+std::size_t walk(const Adjacency &adjacency, nodeId_t root, bool byDegree,
+                 std::vector<char> &visited, std::vector<nodeId_t> &order, std::size_t &lastLevel)
+{
+    visited[root] = true;
+    order.push_back(root);
+    std::size_t levels = 1;
+    lastLevel = order.size() - 1;
+    std::size_t levelEnd = order.size();
+    for (std::size_t head = order.size() - 1; head < order.size(); ++head)
+    {
+        if (head == levelEnd)
+        {
+            ++levels;
+            lastLevel = head;
+            levelEnd = order.size();
+        }
+        nodeId_t v = order[head];
+        std::size_t first = order.size();
+        for (std::size_t i = adjacency.offsets[v]; i < adjacency.offsets[v + 1]; ++i)
+        {
+            nodeId_t u = adjacency.adjacent[i];
+            if (!visited[u])
+            {
+                visited[u] = true;
+                order.push_back(u);
+            }
+        }
+        if (byDegree)
+        {
+            std::stable_sort(order.begin() + first, order.end(), [&](nodeId_t a, nodeId_t b) {
+                return adjacency.degree(a) < adjacency.degree(b);
+            });
+        }
+    }
+    return levels;
+}
+
+// Node of the least degree on the last level of the deepest walk, walks are
+// repeated from such nodes while they get deeper (George and Liu)
+nodeId_t findPeripheral(const Adjacency &adjacency, nodeId_t root)
+{
+    std::vector<char> visited(adjacency.offsets.size() - 1);
+    std::vector<nodeId_t> order;
+    std::size_t depth = 0;
+    for (std::size_t attempt = 0; attempt < peripheralWalks; ++attempt)
+    {
+        std::fill(visited.begin(), visited.end(), false);
+        order.clear();
+        std::size_t lastLevel = 0;
+        std::size_t levels = walk(adjacency, root, false, visited, order, lastLevel);
+        if (levels <= depth)
+        {
+            break;
+        }
+        depth = levels;
+        nodeId_t next = *std::min_element(order.begin() + lastLevel, order.end(), [&](nodeId_t a, nodeId_t b) {
+            return adjacency.degree(a) < adjacency.degree(b);
+        });
+        if (next == root)
+        {
+            break;
+        }
+        root = next;
+    }
+    return root;
+}
+} // namespace
+
+std::vector<nodeId_t> localityOrder(const Graph &graph, nodeId_t root, nodeOrder order)
+{
+    Adjacency adjacency = makeAdjacency(graph);
+    std::size_t size = graph.nodes().size();
+    std::vector<char> visited(size, false);
+    std::vector<nodeId_t> result;
+    result.reserve(size);
+    std::size_t lastLevel = 0;
+    auto component = [&](nodeId_t start) {
+        if (order == nodeOrder::RCM)
+        {
+            start = findPeripheral(adjacency, start);
+        }
+        walk(adjacency, start, order == nodeOrder::RCM, visited, result, lastLevel);
+    };
+    if (root >= 0 && static_cast<std::size_t>(root) < size && !graph.isRemoved(root))
+    {
+        component(root);
+    }
+    for (std::size_t v = 0; v < size; ++v)
+    {
+        if (!visited[v] && !graph.isRemoved(v))
+        {
+            component(v);
+        }
+    }
+    if (order == nodeOrder::RCM)
+    {
+        std::reverse(result.begin(), result.end());
+    }
+    return result;
+}
+} // namespace van_kampen
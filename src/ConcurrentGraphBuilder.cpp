@@ -0,0 +1,168 @@
+#include <stdexcept>
+
+#include "ConcurrentGraphBuilder.hpp"
+#include "Utility.hpp"
+
+namespace van_kampen
+{
+ConcurrentGraphBuilder::ConcurrentGraphBuilder(std::size_t chunkSize)
+    : chunkSize_(std::max<std::size_t>(1, chunkSize))
+{
+    for (auto &segment : segments_)
+    {
+        segment.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+ConcurrentGraphBuilder::~ConcurrentGraphBuilder()
+{
+    for (auto &segment : segments_)
+    {
+        delete[] segment.load(std::memory_order_relaxed);
+    }
+}
+
+ConcurrentGraphBuilder::Allocator::Allocator(ConcurrentGraphBuilder &builder) noexcept
+    : builder_(builder) {}
+
+nodeId_t ConcurrentGraphBuilder::Allocator::addNode()
+{
+    if (next_ == end_)
+    {
+        next_ = builder_.take(builder_.chunkSize_);
+        end_ = next_ + builder_.chunkSize_;
+    }
+    builder_.slot(next_).used = true;
+    return next_++;
+}
+
+ConcurrentGraphBuilder::Allocator ConcurrentGraphBuilder::allocator() noexcept
+{
+    return Allocator(*this);
+}
+
+nodeId_t ConcurrentGraphBuilder::addNode()
+{
+    nodeId_t id = take(1);
+    slot(id).used = true;
+    return id;
+}
+
+transitionList_t &ConcurrentGraphBuilder::transitions(nodeId_t id)
+{
+    if (id < 0 || static_cast<std::size_t>(id) >= size() || !slot(id).used)
+    {
+        throw std::out_of_range("node is not added to builder");
+    }
+    return slot(id).transitions;
+}
+
+std::size_t ConcurrentGraphBuilder::size() const noexcept
+{
+    return size_.load(std::memory_order_acquire);
+}
+
+nodeId_t ConcurrentGraphBuilder::take(std::size_t count)
+{
+    return size_.fetch_add(count, std::memory_order_acq_rel);
+}
+
+ConcurrentGraphBuilder::Slot &ConcurrentGraphBuilder::slot(nodeId_t id)
+{
+    // Segment k starts at chunkSize * (2^k - 1)
+    std::size_t index = static_cast<std::size_t>(id) / chunkSize_ + 1, segment = 0;
+    while (index >> (segment + 1))
+    {
+        ++segment;
+    }
+    if (segment >= segmentsCount)
+    {
+        throw std::length_error("too many nodes in builder");
+    }
+    std::size_t offset = static_cast<std::size_t>(id) - chunkSize_ * ((std::size_t{1} << segment) - 1);
+    Slot *slots = segments_[segment].load(std::memory_order_acquire);
+    if (!slots)
+    {
+        Slot *created = new Slot[chunkSize_ << segment];
+        if (segments_[segment].compare_exchange_strong(slots, created, std::memory_order_acq_rel))
+        {
+            slots = created;
+        }
+        else
+        {
+            delete[] created; // Other thread was first
+        }
+    }
+    return slots[offset];
+}
+
+std::vector<nodeId_t> ConcurrentGraphBuilder::build(Graph &graph, nodeId_t root, std::size_t threads)
+{
+    if (!graph.nodes().empty())
+    {
+        throw std::logic_error("builder nodes can be moved to empty graph only");
+    }
+    const std::size_t count = size();
+    std::vector<nodeId_t> newIds(count, Node::makeNonexistantNode());
+    std::vector<nodeId_t> order;
+    auto visit = [&](nodeId_t v) {
+        if (Node::isNonexistantNode(newIds[v]))
+        {
+            newIds[v] = order.size();
+            order.push_back(v);
+        }
+    };
+    if (root >= 0 && static_cast<std::size_t>(root) < count && slot(root).used)
+    {
+        visit(root);
+        for (std::size_t head = 0; head < order.size(); ++head)
+        {
+            for (const Transition &tr : slot(order[head]).transitions)
+            {
+                visit(tr.to);
+            }
+        }
+    }
+    for (std::size_t v = 0; v < count; ++v)
+    {
+        if (slot(v).used)
+        {
+            visit(v);
+        }
+    }
+
+    for (std::size_t i = 0; i < order.size(); ++i)
+    {
+        graph.addNode();
+    }
+    auto move = [&](std::size_t i) {
+        transitionList_t &transitions = slot(order[i]).transitions;
+        for (Transition &tr : transitions)
+        {
+            tr.to = newIds[tr.to];
+        }
+        return std::move(transitions);
+    };
+    if (graph.eventLog())
+    {
+        // Events are written in order of nodes
+        for (std::size_t i = 0; i < order.size(); ++i)
+        {
+            for (Transition &tr : move(i))
+            {
+                graph.node(i).addTransition(std::move(tr));
+            }
+        }
+    }
+    else
+    {
+        utility::parallelFor(order.size(), threads, [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                graph.node(i).transitions() = move(i);
+            }
+        });
+    }
+    return newIds;
+}
+} // namespace van_kampen
@@ -1,4 +1,5 @@
 #include "ConsoleFlags.hpp"
+#include "Utility.hpp"
 
 namespace van_kampen
 {
@@ -7,18 +8,52 @@ ConsoleFlags::ConsoleFlags(int argc, const char **argv)
     cxxopts::Options options("vankamp-vis", "Van Kampen diagram visualisation tool");
     options.add_options()(
         "i,input", "Specify input file", cxxopts::value(inputFileName), "(required)")(
-        "f,format", "Output format", cxxopts::value(outputFormatString), "dot/edges")(
+        "f,format", "Output format", cxxopts::value(outputFormatString), "dot/edges/svg/bin")(
         "o,output", "Specify output filename, '<input-filename>-diagram.<format>' by default", cxxopts::value(outputFileName), "")(
         "c,circuit-output", "Set boundary circuit output file, '<input-filename>-circuit.txt' by default", cxxopts::value(wordOutputFileName), "")(
         "shuffle", "Shuffle representation before generation", cxxopts::value(shuffleGroup)->default_value("false"), "")(
+        "seed", "Set seed of shuffle and portfolio orderings", cxxopts::value(seed)->default_value("1"), "")(
         "not-sort", "Do not sort representation by relation legth before generation", cxxopts::value(notSort)->default_value("false"), "")(
+        "affinity-order", "Order relations by greedy chain of matching k-mers from hub after sorting", cxxopts::value(affinityOrder)->default_value("false"), "")(
+        "affinity-k", "Set length of k-mers matched by affinity ordering", cxxopts::value(affinityK)->default_value("2"), "")(
         "q,quiet", "Do not log status to console", cxxopts::value(quiet)->default_value("false"), "")(
         "l,limit", "Set limit for used cells (valid for iterative and large-first)", cxxopts::value(cellsLimit), "")(
         "per-large", "Set the number of small words used to build one big one (valid for large-first)", cxxopts::value(perLarge)->default_value("10"), "")(
         "large-first", "Build diagramm with large-first algorithm", cxxopts::value(largeFirstAlgo))(
         "iterative", "Build diagramm with iterative algorithm", cxxopts::value(iterativeAlgo)->default_value("true"))(
         "merging", "Build diagramm with merging algorithm (not recommended)", cxxopts::value(mergingAlgo))(
-        "s,split", "Split diagram in smaller components", cxxopts::value(split)->default_value("false"))(
+        "sharded", "Build diagramm on hub segments in parallel and stitch them", cxxopts::value(shardedAlgo))(
+        "shards", "Set number of hub segments for sharded algorithm, threads count by default", cxxopts::value(shards)->default_value("0"), "")(
+        "lookahead", "Build diagramm binding relation which gives the shortest boundary among the next ones", cxxopts::value(lookaheadAlgo))(
+        "lookahead-width", "Set number of relations tried on every lookahead level", cxxopts::value(lookaheadWidth)->default_value("4"), "")(
+        "lookahead-depth", "Set number of lookahead levels", cxxopts::value(lookaheadDepth)->default_value("1"), "")(
+        "scheduled", "Retry only relations which may match changed boundary (valid for iterative)", cxxopts::value(scheduled)->default_value("false"))(
+        "portfolio", "Run given number of generations with different orderings concurrently, keep the best; iterative and large-first alternate unless scheduled", cxxopts::value(portfolio)->default_value("1"), "")(
+        "portfolio-all", "Do not stop portfolio runs when one of them binds all relations", cxxopts::value(portfolioAll)->default_value("false"))(
+        "s,split", "Split diagram into balanced parts with few cut edges", cxxopts::value(split)->default_value("false"))(
+        "parts", "Set number of split parts, one per 2000 nodes by default", cxxopts::value(parts)->default_value("0"), "")(
+        "lod", "Write overview of diagram contracted to super-nodes and their detail files", cxxopts::value(lod)->default_value("false"))(
+        "lod-fanout", "Set number of finer level nodes per super-node", cxxopts::value(lodFanout)->default_value("64"), "")(
+        "compact", "Drop removed nodes and renumber the rest so that neighbours get close ids", cxxopts::value(compact)->default_value("false"))(
+        "compact-order", "Node order of compaction, breadth first from terminal or reverse Cuthill-McKee", cxxopts::value(compactOrderString), "bfs/rcm")(
+        "cache", "Reuse diagrams generated with same relations and flags from directory", cxxopts::value(cacheDirectory), "")(
+        "cache-size", "Set cache directory size limit in megabytes", cxxopts::value(cacheSize)->default_value("1024"), "")(
+        "layout", "Compute node positions and print them to dot output", cxxopts::value(layout)->default_value("false"))(
+        "layout-iterations", "Set number of force-directed layout iterations", cxxopts::value(layoutIterations)->default_value("100"), "")(
+        "coordinates", "Compute node positions and write them to file", cxxopts::value(coordinatesFileName), "")(
+        "crossings", "Compute node positions and write crossing edges to file", cxxopts::value(crossingsFileName), "")(
+        "spectrum", "Estimate Laplacian spectrum of diagram and write it to file", cxxopts::value(spectrumFileName), "")(
+        "spectrum-k", "Set number of smallest and largest eigenvalues to estimate", cxxopts::value(spectrumCount)->default_value("10"), "")(
+        "spectrum-bins", "Set number of eigenvalue histogram bins", cxxopts::value(spectrumBins)->default_value("100"), "")(
+        "spectrum-steps", "Set number of Lanczos iterations of histogram runs", cxxopts::value(spectrumSteps)->default_value("100"), "")(
+        "verify", "Check that generated diagram is valid, exit with error if it is not", cxxopts::value(verify)->default_value("false"))(
+        "faces", "Write faces (cells) of diagram to file", cxxopts::value(facesFileName), "")(
+        "analyze", "Write statistics of diagram to file as JSON", cxxopts::value(analyzeFileName), "")(
+        "analyze-samples", "Set number of BFS sources of approximate eccentricities on large diagrams, 0 for exact", cxxopts::value(analyzeSamples)->default_value("16"), "")(
+        "load", "Load diagram written before in bin, dot or edges format instead of generating it", cxxopts::value(loadFileName), "")(
+        "event-log", "Write graph changes to binary log file while diagram is generated", cxxopts::value(eventLogFileName), "")(
+        "max-memory", "Keep graph nodes and transitions in RAM up to given megabytes, the rest in temporary mapped file", cxxopts::value(maxMemory)->default_value("0"), "")(
+        "j,threads", "Set number of worker threads, all available by default", cxxopts::value(threads)->default_value("0"), "")(
         "h,help", "Print usage");
 
     auto result = options.parse(argc, argv);
@@ -31,9 +66,35 @@ ConsoleFlags::ConsoleFlags(int argc, const char **argv)
     {
         outputFormat = graphOutputFormat::TXT_EDGES;
     }
+    else if (outputFormatString == "svg")
+    {
+        outputFormat = graphOutputFormat::SVG;
+        layout = true;
+    }
+    else if (outputFormatString == "bin")
+    {
+        outputFormat = graphOutputFormat::BINARY;
+    }
     else
     {
-        throw cxxopts::invalid_option_format_error("Format can be either dot or edges");
+        throw cxxopts::invalid_option_format_error("Format can be either dot, edges, svg or bin");
+    }
+
+    if (compactOrderString == "bfs")
+    {
+        compactOrder = nodeOrder::BFS;
+    }
+    else if (compactOrderString == "rcm")
+    {
+        compactOrder = nodeOrder::RCM;
+    }
+    else
+    {
+        throw cxxopts::invalid_option_format_error("Compaction order can be either bfs or rcm");
+    }
+    if (result.count("compact-order"))
+    {
+        compact = true;
     }
 
     std::cout << outputFormatString << std::endl;
@@ -44,21 +105,79 @@ ConsoleFlags::ConsoleFlags(int argc, const char **argv)
         std::cout << options.help() << std::endl;
         exit(0);
     }
-    if (!result.count("input"))
+    if (!result.count("input") && loadFileName.empty())
     {
         throw cxxopts::option_required_exception("input");
     }
     hasCellsLimit = result.count("limit");
+    if (split && lod)
+    {
+        throw std::invalid_argument("split and level of detail outputs can not be used together");
+    }
 
-    outputFileNameWoEx = inputFileName + "-diagram";
+    if (threads == 0)
+    {
+        threads = utility::defaultThreadsCount();
+    }
+    if (!coordinatesFileName.empty() || !crossingsFileName.empty())
+    {
+        layout = true;
+    }
+
+    // Loaded diagram may have no relations file
+    const std::string &baseFileName = inputFileName.empty() ? loadFileName : inputFileName;
+    outputFileNameWoEx = baseFileName + "-diagram";
 
     if (outputFileName.empty())
     {
-        outputFileName = inputFileName + "-diagram." + outputFormatString;
+        outputFileName = baseFileName + "-diagram." + outputFormatString;
     }
     if (wordOutputFileName.empty())
     {
-        wordOutputFileName = inputFileName + "-circuit.txt";
+        wordOutputFileName = baseFileName + "-circuit.txt";
+    }
+}
+
+GenerationParameters ConsoleFlags::generation() const
+{
+    GenerationParameters parameters;
+    if (shardedAlgo)
+    {
+        parameters.algorithm = algorithmType::SHARDED;
+    }
+    else if (lookaheadAlgo)
+    {
+        parameters.algorithm = algorithmType::LOOKAHEAD;
+    }
+    else if (iterativeAlgo)
+    {
+        parameters.algorithm = algorithmType::ITERATIVE;
+    }
+    else if (mergingAlgo)
+    {
+        parameters.algorithm = algorithmType::MERGING;
+    }
+    else if (largeFirstAlgo)
+    {
+        parameters.algorithm = algorithmType::LARGE_FIRST;
+    }
+    else
+    {
+        throw std::invalid_argument("no generation algorithm is selected");
     }
+    parameters.cellsLimit = cellsLimit;
+    parameters.perLarge = perLarge;
+    parameters.shuffle = shuffleGroup;
+    parameters.seed = seed;
+    parameters.sort = !notSort;
+    parameters.affinity = affinityOrder;
+    parameters.affinityK = affinityK;
+    parameters.shards = shards ? shards : threads;
+    parameters.threads = threads;
+    parameters.scheduled = scheduled;
+    parameters.lookaheadWidth = lookaheadWidth;
+    parameters.lookaheadDepth = lookaheadDepth;
+    parameters.quiet = quiet;
+    return parameters;
 }
 } // namespace van_kampen
@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "Crossings.hpp"
+#include "Utility.hpp"
+
+namespace van_kampen
+{
+namespace
+{
+// Grid has at most this many cells per edge
+const std::size_t cellsPerEdge = 4;
+
+struct Grid
+{
+    Point origin;
+    double side = 1.0;
+    std::size_t columns = 1, rows = 1;
+
+    std::size_t column(double x) const
+    {
+        return static_cast<std::size_t>(std::clamp((x - origin.x) / side, 0.0, static_cast<double>(columns - 1)));
+    }
+
+    std::size_t row(double y) const
+    {
+        return static_cast<std::size_t>(std::clamp((y - origin.y) / side, 0.0, static_cast<double>(rows - 1)));
+    }
+
+    // Append ids of cells crossed by segment in increasing order
+    // Cells are widened by small margin, so segment passing through corner
+    // or along border is put into cells on both sides
+    void cells(const Segment &segment, std::vector<std::size_t> &result) const
+    {
+        double margin = side * 1e-9;
+        const Point &a = segment.first, &b = segment.second;
+        std::size_t firstRow = row(std::min(a.y, b.y) - margin), lastRow = row(std::max(a.y, b.y) + margin);
+        for (std::size_t r = firstRow; r <= lastRow; ++r)
+        {
+            // Part of segment inside horizontal band of row
+            double low = origin.y + side * r - margin, high = low + side + 2 * margin;
+            double xLow = std::min(a.x, b.x), xHigh = std::max(a.x, b.x);
+            if (a.y != b.y)
+            {
+                double t1 = std::clamp((low - a.y) / (b.y - a.y), 0.0, 1.0);
+                double t2 = std::clamp((high - a.y) / (b.y - a.y), 0.0, 1.0);
+                double x1 = a.x + (b.x - a.x) * t1, x2 = a.x + (b.x - a.x) * t2;
+                xLow = std::min(x1, x2);
+                xHigh = std::max(x1, x2);
+            }
+            for (std::size_t c = column(xLow - margin), last = column(xHigh + margin); c <= last; ++c)
+            {
+                result.push_back(r * columns + c);
+            }
+        }
+    }
+};
+
+Grid makeGrid(const std::vector<Segment> &segments)
+{
+    Grid grid;
+    Point low = segments.front().first, high = low;
+    double length = 0.0;
+    for (const Segment &segment : segments)
+    {
+        for (const Point &p : {segment.first, segment.second})
+        {
+            low = {std::min(low.x, p.x), std::min(low.y, p.y)};
+            high = {std::max(high.x, p.x), std::max(high.y, p.y)};
+        }
+        length += distance(segment.first, segment.second);
+    }
+    double width = high.x - low.x, height = high.y - low.y;
+    double limit = static_cast<double>(segments.size() * cellsPerEdge);
+    // Cell side is average edge length, unless there would be too many cells
+    grid.side = std::max({length / segments.size(), std::sqrt(width * height / limit), std::max(width, height) / limit});
+    if (!(grid.side > 0.0))
+    {
+        grid.side = 1.0;
+    }
+    grid.origin = low;
+    grid.columns = static_cast<std::size_t>(width / grid.side) + 1;
+    grid.rows = static_cast<std::size_t>(height / grid.side) + 1;
+    return grid;
+}
+
+// Returns the first cell which is in both sorted lists
+std::size_t firstCommon(const std::size_t *a, const std::size_t *aEnd, const std::size_t *b, const std::size_t *bEnd)
+{
+    while (*a != *b)
+    {
+        if (*a < *b)
+        {
+            ++a;
+        }
+        else
+        {
+            ++b;
+        }
+        if (a == aEnd || b == bEnd)
+        {
+            return static_cast<std::size_t>(-1);
+        }
+    }
+    return *a;
+}
+} // namespace
+
+CrossingReport countCrossings(const Graph &graph, const CrossingParameters &parameters)
+{
+    CrossingReport report;
+    const auto &nodes = graph.nodes();
+    std::vector<std::pair<nodeId_t, nodeId_t>> edges;
+    for (std::size_t u = 0; u < nodes.size(); ++u)
+    {
+        if (graph.isRemoved(u))
+        {
+            continue;
+        }
+        for (const Transition &tr : nodes[u].transitions())
+        {
+            if (static_cast<nodeId_t>(u) < tr.to && !graph.isRemoved(tr.to))
+            {
+                edges.emplace_back(u, tr.to);
+            }
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    report.edges = edges.size();
+    if (edges.empty())
+    {
+        return report;
+    }
+    std::vector<Segment> segments(edges.size());
+    for (std::size_t e = 0; e < edges.size(); ++e)
+    {
+        segments[e] = {nodes[edges[e].first].position, nodes[edges[e].second].position};
+    }
+    Grid grid = makeGrid(segments);
+    std::size_t threads = std::max<std::size_t>(1, parameters.threads);
+
+    // Cells of every edge, in parallel by chunks of edges
+    std::vector<std::vector<std::size_t>> chunkCells(threads), chunkOffsets(threads);
+    utility::parallelFor(edges.size(), threads, [&](std::size_t begin, std::size_t end, std::size_t chunk) {
+        auto &cells = chunkCells[chunk];
+        auto &offsets = chunkOffsets[chunk];
+        offsets.push_back(0);
+        for (std::size_t e = begin; e < end; ++e)
+        {
+            grid.cells(segments[e], cells);
+            offsets.push_back(cells.size());
+        }
+    });
+    std::vector<std::size_t> edgeOffsets(1, 0), edgeCells;
+    for (std::size_t chunk = 0; chunk < threads; ++chunk)
+    {
+        for (std::size_t i = 1; i < chunkOffsets[chunk].size(); ++i)
+        {
+            edgeOffsets.push_back(edgeCells.size() + chunkOffsets[chunk][i]);
+        }
+        edgeCells.insert(edgeCells.end(), chunkCells[chunk].begin(), chunkCells[chunk].end());
+        std::vector<std::size_t>().swap(chunkCells[chunk]);
+    }
+
+    // Edges of every cell, by counting sort
+    std::size_t cellsCount = grid.columns * grid.rows;
+    std::vector<std::size_t> cellOffsets(cellsCount + 1, 0), cellEdges(edgeCells.size());
+    for (std::size_t cell : edgeCells)
+    {
+        ++cellOffsets[cell + 1];
+    }
+    std::partial_sum(cellOffsets.begin(), cellOffsets.end(), cellOffsets.begin());
+    {
+        std::vector<std::size_t> cursor(cellOffsets.begin(), cellOffsets.end() - 1);
+        for (std::size_t e = 0; e < edges.size(); ++e)
+        {
+            for (std::size_t i = edgeOffsets[e]; i < edgeOffsets[e + 1]; ++i)
+            {
+                cellEdges[cursor[edgeCells[i]]++] = e;
+            }
+        }
+    }
+
+    // Pair is tested in every common cell, but counted only in the first one
+    std::vector<std::size_t> counts(threads);
+    std::vector<std::vector<EdgeCrossing>> listed(threads);
+    utility::parallelFor(cellsCount, threads, [&](std::size_t begin, std::size_t end, std::size_t chunk) {
+        for (std::size_t cell = begin; cell < end; ++cell)
+        {
+            for (std::size_t i = cellOffsets[cell]; i < cellOffsets[cell + 1]; ++i)
+            {
+                std::size_t e = cellEdges[i];
+                for (std::size_t j = i + 1; j < cellOffsets[cell + 1]; ++j)
+                {
+                    std::size_t f = cellEdges[j];
+                    if (edges[e].first == edges[f].first || edges[e].first == edges[f].second ||
+                        edges[e].second == edges[f].first || edges[e].second == edges[f].second ||
+                        !isCrossing(segments[e], segments[f]))
+                    {
+                        continue;
+                    }
+                    const std::size_t *cells = edgeCells.data();
+                    if (firstCommon(cells + edgeOffsets[e], cells + edgeOffsets[e + 1],
+                                    cells + edgeOffsets[f], cells + edgeOffsets[f + 1]) != cell)
+                    {
+                        continue;
+                    }
+                    ++counts[chunk];
+                    if (listed[chunk].size() < parameters.maxListed)
+                    {
+                        listed[chunk].push_back({edges[e], edges[f], crossingPoint(segments[e], segments[f])});
+                    }
+                }
+            }
+        }
+    });
+    for (std::size_t chunk = 0; chunk < threads; ++chunk)
+    {
+        report.crossings += counts[chunk];
+        for (EdgeCrossing &crossing : listed[chunk])
+        {
+            if (report.listed.size() < parameters.maxListed)
+            {
+                report.listed.push_back(crossing);
+            }
+        }
+    }
+    return report;
+}
+
+void printCrossings(const CrossingReport &report, std::ostream &os)
+{
+    os << "# " << report.crossings << " crossings of " << report.edges << " edges";
+    if (report.listed.size() < report.crossings)
+    {
+        os << ", first " << report.listed.size() << " are listed";
+    }
+    os << '\n';
+    for (const EdgeCrossing &crossing : report.listed)
+    {
+        os << crossing.first.first << ' ' << crossing.first.second << ' '
+           << crossing.second.first << ' ' << crossing.second.second << ' '
+           << crossing.at.x << ' ' << crossing.at.y << '\n';
+    }
+    os.flush();
+}
+} // namespace van_kampen
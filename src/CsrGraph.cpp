@@ -0,0 +1,24 @@
+#include "CsrGraph.hpp"
+
+namespace van_kampen
+{
+CsrGraph::CsrGraph(const Graph &graph)
+{
+    offsets.reserve(graph.nodes().size() + 1);
+    offsets.push_back(0);
+    for (const Node &node : graph.nodes())
+    {
+        if (!graph.isRemoved(node.getId()))
+        {
+            for (const Transition &tr : node.transitions())
+            {
+                if (tr.to != node.getId() && !graph.isRemoved(tr.to))
+                {
+                    adjacent.push_back(tr.to);
+                }
+            }
+        }
+        offsets.push_back(adjacent.size());
+    }
+}
+} // namespace van_kampen
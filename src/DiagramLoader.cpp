@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <stdexcept>
+#include <streambuf>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "DiagramLoader.hpp"
+
+namespace van_kampen
+{
+namespace
+{
+// Headers of graph and diagram written by Graph::writeBinary and Diagramm::writeBinary
+const char graphMagic[] = "VKGRAPH1";
+const char diagramMagic[] = "VKDIAGR1";
+
+// Read-only mapping of whole file
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string &fileName)
+    {
+        int file = open(fileName.c_str(), O_RDONLY);
+        if (file < 0)
+        {
+            throw std::invalid_argument("cannot open '" + fileName + "'");
+        }
+        struct stat status;
+        if (fstat(file, &status) != 0)
+        {
+            close(file);
+            throw std::invalid_argument("cannot open '" + fileName + "'");
+        }
+        size_ = status.st_size;
+        if (size_)
+        {
+            void *data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file, 0);
+            if (data == MAP_FAILED)
+            {
+                close(file);
+                throw std::runtime_error("cannot map '" + fileName + "' to memory");
+            }
+            madvise(data, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char *>(data);
+        }
+        close(file);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile()
+    {
+        if (data_)
+        {
+            munmap(const_cast<char *>(data_), size_);
+        }
+    }
+
+    const char *begin() const noexcept { return data_; }
+    const char *end() const noexcept { return data_ + size_; }
+
+private:
+    const char *data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+// Stream over mapped bytes, so binary readers do not copy the file
+class MemoryBuffer : public std::streambuf
+{
+public:
+    MemoryBuffer(const char *begin, const char *end)
+    {
+        setg(const_cast<char *>(begin), const_cast<char *>(begin), const_cast<char *>(end));
+    }
+};
+
+bool startsWith(const char *begin, const char *end, const char *prefix)
+{
+    std::size_t length = std::strlen(prefix);
+    return static_cast<std::size_t>(end - begin) >= length && std::memcmp(begin, prefix, length) == 0;
+}
+
+// Binary files start with magic, edges text has only digits and spaces
+graphOutputFormat detectFormat(const char *begin, const char *end)
+{
+    if (startsWith(begin, end, graphMagic) || startsWith(begin, end, diagramMagic))
+    {
+        return graphOutputFormat::BINARY;
+    }
+    if (startsWith(begin, end, "digraph"))
+    {
+        return graphOutputFormat::DOT;
+    }
+    const char *lineEnd = std::find(begin, std::min(end, begin + 256), '\n');
+    bool text = std::all_of(begin, lineEnd, [](char c) {
+        return (c >= '0' && c <= '9') || c == ' ' || c == '\t' || c == '\r';
+    });
+    if (!text)
+    {
+        throw std::invalid_argument("diagram file has unknown format");
+    }
+    return graphOutputFormat::TXT_EDGES;
+}
+} // namespace
+
+graphOutputFormat loadDiagram(const std::string &fileName, Graph &graph, Diagramm &diagramm, std::size_t threads)
+{
+    if (!graph.nodes().empty())
+    {
+        throw std::logic_error("diagram can be loaded to empty graph only");
+    }
+    MappedFile file(fileName);
+    graphOutputFormat format = detectFormat(file.begin(), file.end());
+    if (format != graphOutputFormat::BINARY)
+    {
+        graph.readText(file.begin(), file.end(), format, threads);
+        return format;
+    }
+    MemoryBuffer buffer(file.begin(), file.end());
+    std::istream is(&buffer);
+    if (startsWith(file.begin(), file.end(), graphMagic))
+    {
+        graph.readBinary(is);
+    }
+    else
+    {
+        diagramm.readBinary(is);
+    }
+    return format;
+}
+} // namespace van_kampen
@@ -0,0 +1,73 @@
+#include "EdgePriorities.hpp"
+#include "Utility.hpp"
+
+namespace van_kampen
+{
+void computeEdgePriorities(Graph &graph, const CellLog &cells, std::size_t threads)
+{
+    if (graph.inTransaction())
+    {
+        throw std::logic_error("edge priorities can not be computed in transaction");
+    }
+    std::size_t nodesCount = graph.nodes().size();
+    auto isValid = [&](nodeId_t v) {
+        return v >= 0 && static_cast<std::size_t>(v) < nodesCount && !graph.isRemoved(v);
+    };
+
+    // Group contributions by source node so that nodes are updated independently
+    struct Contribution
+    {
+        nodeId_t to;
+        double value;
+    };
+    std::vector<std::size_t> offsets(nodesCount + 1, 0);
+    auto forEachEdge = [&](auto &&body) {
+        for (std::size_t cell = 0; cell < cells.size(); ++cell)
+        {
+            std::size_t begin = cells.offsets[cell], end = cells.offsets[cell + 1];
+            double value = 1.0 / static_cast<double>(end - begin);
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                nodeId_t a = cells.nodes[i], b = cells.nodes[i + 1 == end ? begin : i + 1];
+                if (isValid(a) && isValid(b))
+                {
+                    body(a, b, value);
+                    body(b, a, value);
+                }
+            }
+        }
+    };
+    forEachEdge([&](nodeId_t from, nodeId_t, double) { ++offsets[from + 1]; });
+    for (std::size_t v = 0; v < nodesCount; ++v)
+    {
+        offsets[v + 1] += offsets[v];
+    }
+    std::vector<Contribution> contributions(offsets.back());
+    std::vector<std::size_t> filled(offsets.begin(), offsets.end() - 1);
+    forEachEdge([&](nodeId_t from, nodeId_t to, double value) {
+        contributions[filled[from]++] = {to, value};
+    });
+
+    utility::parallelFor(nodesCount, threads, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t v = begin; v < end; ++v)
+        {
+            auto &transitions = graph.node(v).transitions();
+            for (Transition &tr : transitions)
+            {
+                tr.priority = 0.0;
+            }
+            for (std::size_t c = offsets[v]; c < offsets[v + 1]; ++c)
+            {
+                for (Transition &tr : transitions)
+                {
+                    if (tr.to == contributions[c].to)
+                    {
+                        tr.priority += contributions[c].value;
+                        break;
+                    }
+                }
+            }
+        }
+    });
+}
+} // namespace van_kampen
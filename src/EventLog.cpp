@@ -0,0 +1,383 @@
+#include <cstring>
+#include <vector>
+
+#include "EventLog.hpp"
+#include "Graph.hpp"
+
+namespace van_kampen
+{
+namespace
+{
+const char logMagic[] = "VKEVLOG2";
+
+// Below this many bytes log is not flushed at cell ends
+const std::size_t flushBytes = 1 << 16;
+
+enum transitionFlags : std::uint8_t
+{
+    LABEL_REVERSED = 1,
+    EDGE_IN_SQUARE = 2,
+    EDGE_IN_HUB = 4,
+};
+
+// Thrown by reader when log ends in the middle of event
+struct logEnded
+{
+};
+
+class LogReader
+{
+public:
+    explicit LogReader(std::istream &is)
+        : buffer_(*is.rdbuf()) {}
+
+    bool ended()
+    {
+        return buffer_.sgetc() == std::char_traits<char>::eof();
+    }
+
+    std::uint8_t byte()
+    {
+        auto c = buffer_.sbumpc();
+        if (c == std::char_traits<char>::eof())
+        {
+            throw logEnded{};
+        }
+        return static_cast<std::uint8_t>(c);
+    }
+
+    std::uint64_t varint()
+    {
+        std::uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7)
+        {
+            std::uint8_t c = byte();
+            value |= static_cast<std::uint64_t>(c & 0x7f) << shift;
+            if (!(c & 0x80))
+            {
+                return value;
+            }
+        }
+        throw std::invalid_argument("event log is corrupted");
+    }
+
+    std::string string()
+    {
+        std::string value(varint(), '\0');
+        for (char &c : value)
+        {
+            c = static_cast<char>(byte());
+        }
+        return value;
+    }
+
+private:
+    std::streambuf &buffer_;
+};
+} // namespace
+
+EventLog::EventLog(std::ostream &os)
+    : writer_(os), os_(os)
+{
+    writer_ << std::string_view(logMagic, sizeof(logMagic) - 1);
+}
+
+EventLog::~EventLog()
+{
+    flush();
+}
+
+void EventLog::put(eventType type)
+{
+    char c = static_cast<char>(type);
+    writer_ << c;
+    ++unflushed_;
+}
+
+void EventLog::put(std::uint64_t value)
+{
+    char bytes[10];
+    std::size_t size = 0;
+    do
+    {
+        bytes[size++] = static_cast<char>((value & 0x7f) | (value >= 0x80 ? 0x80 : 0));
+        value >>= 7;
+    } while (value);
+    writer_ << std::string_view(bytes, size);
+    unflushed_ += size;
+}
+
+// Nonexistant node is written as zero, others are shifted by one
+void EventLog::putNode(nodeId_t node)
+{
+    put(static_cast<std::uint64_t>(static_cast<std::int64_t>(node) + 1));
+}
+
+void EventLog::addNode()
+{
+    put(eventType::NODE);
+}
+
+void EventLog::addTransition(nodeId_t from, const Transition &tr, bool front)
+{
+    auto [it, added] = labelIds_.emplace(tr.label.name, labelIds_.size());
+    if (added)
+    {
+        put(eventType::LABEL);
+        put(tr.label.name.size());
+        writer_ << tr.label.name;
+        unflushed_ += tr.label.name.size();
+    }
+    put(front ? eventType::FRONT_TRANSITION : eventType::TRANSITION);
+    putNode(from);
+    putNode(tr.to);
+    put(it->second);
+    put((tr.label.reversed ? LABEL_REVERSED : 0) |
+        (tr.isInSquare ? EDGE_IN_SQUARE : 0) |
+        (tr.isInHub ? EDGE_IN_HUB : 0));
+}
+
+void EventLog::swapLastAdditions(nodeId_t node)
+{
+    put(eventType::SWAP_LAST);
+    putNode(node);
+}
+
+void EventLog::mergeNodes(nodeId_t alive, nodeId_t dead, const std::unordered_set<nodeId_t> &untouchable)
+{
+    put(eventType::MERGE);
+    putNode(alive);
+    putNode(dead);
+    put(untouchable.size());
+    for (nodeId_t node : untouchable)
+    {
+        putNode(node);
+    }
+}
+
+void EventLog::removeOrientedEdge(nodeId_t a, nodeId_t b)
+{
+    put(eventType::REMOVE_EDGE);
+    putNode(a);
+    putNode(b);
+}
+
+void EventLog::setTerminal(nodeId_t node)
+{
+    put(eventType::TERMINAL);
+    putNode(node);
+}
+
+void EventLog::addCell(const CellLog &cells, std::size_t cell)
+{
+    put(eventType::CELL);
+    put(cells.offsets[cell + 1] - cells.offsets[cell]);
+    for (std::size_t i = cells.offsets[cell]; i < cells.offsets[cell + 1]; ++i)
+    {
+        putNode(cells.nodes[i]);
+    }
+}
+
+void EventLog::setCellsCount(std::size_t cells)
+{
+    put(eventType::CELLS);
+    put(cells);
+    if (unflushed_ >= flushBytes)
+    {
+        flush();
+    }
+}
+
+void EventLog::flush()
+{
+    writer_.flush();
+    os_.flush();
+    unflushed_ = 0;
+}
+
+namespace
+{
+// Read at most limit events of log, apply them to graph and diagram if they are given
+ReplayResult readEvents(std::istream &is, Graph *graph, Diagramm *diagramm, std::size_t limit)
+{
+    LogReader reader(is);
+    std::vector<std::string> labels;
+    std::uint64_t nodes = 0;
+    ReplayResult result;
+    CellLog cells;
+    std::vector<nodeId_t> walk;
+    std::unordered_map<nodeId_t, nodeId_t> merged;
+    auto node = [&]() {
+        std::uint64_t id = reader.varint();
+        if (id == 0 || id > nodes)
+        {
+            throw std::invalid_argument("event log is corrupted");
+        }
+        return static_cast<nodeId_t>(id - 1);
+    };
+    // Arguments of event are read before graph is changed, so incomplete
+    // event at the end of log leaves graph untouched
+    try
+    {
+        while (result.events < limit && !reader.ended())
+        {
+            auto type = static_cast<eventType>(reader.byte());
+            switch (type)
+            {
+            case eventType::LABEL:
+                labels.push_back(reader.string());
+                break;
+
+            case eventType::NODE:
+                ++nodes;
+                if (graph)
+                {
+                    graph->addNode();
+                }
+                break;
+
+            case eventType::TRANSITION:
+            case eventType::FRONT_TRANSITION:
+            {
+                nodeId_t from = node(), to = node();
+                std::uint64_t label = reader.varint();
+                std::uint64_t flags = reader.varint();
+                if (label >= labels.size())
+                {
+                    throw std::invalid_argument("event log is corrupted");
+                }
+                if (!graph)
+                {
+                    break;
+                }
+                GroupElement element{labels[label], static_cast<bool>(flags & LABEL_REVERSED)};
+                if (type == eventType::TRANSITION)
+                {
+                    graph->node(from).addTransition(to, element, flags & EDGE_IN_SQUARE, flags & EDGE_IN_HUB);
+                }
+                else
+                {
+                    graph->node(from).addFrontTransition(to, element, flags & EDGE_IN_SQUARE, flags & EDGE_IN_HUB);
+                }
+                break;
+            }
+
+            case eventType::SWAP_LAST:
+            {
+                nodeId_t v = node();
+                if (graph)
+                {
+                    graph->node(v).swapLastAdditions();
+                }
+                break;
+            }
+
+            case eventType::MERGE:
+            {
+                nodeId_t alive = node(), dead = node();
+                std::unordered_set<nodeId_t> untouchable;
+                for (std::uint64_t count = reader.varint(); count > 0; --count)
+                {
+                    untouchable.insert(node());
+                }
+                if (graph)
+                {
+                    graph->mergeNodes(alive, dead, untouchable);
+                }
+                merged[dead] = alive;
+                break;
+            }
+
+            case eventType::REMOVE_EDGE:
+            {
+                nodeId_t a = node(), b = node();
+                if (graph)
+                {
+                    graph->removeOrientedEdge(a, b);
+                }
+                break;
+            }
+
+            case eventType::TERMINAL:
+            {
+                std::uint64_t id = reader.varint();
+                if (id > nodes)
+                {
+                    throw std::invalid_argument("event log is corrupted");
+                }
+                if (diagramm)
+                {
+                    diagramm->setTerminal(static_cast<nodeId_t>(static_cast<std::int64_t>(id) - 1));
+                }
+                break;
+            }
+
+            case eventType::CELL:
+                walk.clear();
+                for (std::uint64_t count = reader.varint(); count > 0; --count)
+                {
+                    walk.push_back(node());
+                }
+                if (diagramm)
+                {
+                    cells.add(walk.begin(), walk.end());
+                }
+                ++result.cells;
+                break;
+
+            case eventType::CELLS:
+                reader.varint();
+                result.cellEvents = result.events + 1;
+                break;
+
+            default:
+                throw std::invalid_argument("event log is corrupted");
+            }
+            ++result.events;
+        }
+    }
+    catch (const logEnded &)
+    {
+        result.complete = false;
+    }
+    if (diagramm)
+    {
+        // Cells of merged diagrams are logged before merge, with nodes merged away later
+        for (nodeId_t &v : cells.nodes)
+        {
+            for (auto it = merged.find(v); it != merged.end(); it = merged.find(v))
+            {
+                v = it->second;
+            }
+        }
+        diagramm->setCells(std::move(cells));
+    }
+    return result;
+}
+} // namespace
+
+ReplayResult replayEventLog(std::istream &is, Graph &graph, Diagramm &diagramm)
+{
+    if (!graph.nodes().empty())
+    {
+        throw std::logic_error("can not replay event log into non-empty graph");
+    }
+    char magic[sizeof(logMagic) - 1];
+    is.read(magic, sizeof(magic));
+    if (!is || std::memcmp(magic, logMagic, sizeof(magic)) != 0)
+    {
+        throw std::invalid_argument("event log has invalid header");
+    }
+
+    // Log which is still being written is replayed up to its last cell,
+    // so boundary of replayed diagram is closed
+    auto begin = is.tellg();
+    ReplayResult scan = readEvents(is, nullptr, nullptr, static_cast<std::size_t>(-1));
+    is.clear();
+    is.seekg(begin);
+    ReplayResult result = readEvents(is, &graph, &diagramm, scan.complete ? scan.events : scan.cellEvents);
+    result.complete = scan.complete;
+    result.skipped = scan.events - result.events;
+    return result;
+}
+} // namespace van_kampen
@@ -0,0 +1,142 @@
+#include <deque>
+#include <functional>
+#include <unordered_map>
+
+#include "Faces.hpp"
+
+namespace van_kampen
+{
+namespace
+{
+struct DartKey
+{
+    nodeId_t from, to;
+    const GroupElement *label;
+
+    bool operator==(const DartKey &other) const
+    {
+        return from == other.from && to == other.to && *label == *other.label;
+    }
+};
+
+struct DartKeyHash
+{
+    std::size_t operator()(const DartKey &key) const
+    {
+        std::size_t hash = std::hash<std::string>{}(key.label->name) ^ key.label->reversed;
+        hash = hash * 1000003 ^ std::hash<nodeId_t>{}(key.from);
+        return hash * 1000003 ^ std::hash<nodeId_t>{}(key.to);
+    }
+};
+} // namespace
+
+FaceList enumerateFaces(const Graph &graph, const Diagramm &diagramm)
+{
+    const auto &nodes = graph.nodes();
+    std::vector<std::size_t> firstDart(nodes.size() + 1, 0);
+    for (std::size_t v = 0; v < nodes.size(); ++v)
+    {
+        firstDart[v + 1] = firstDart[v] + (graph.isRemoved(v) ? 0 : nodes[v].transitions().size());
+    }
+    auto dartId = [&](nodeId_t v, std::size_t index) { return firstDart[v] + index; };
+
+    // Pair every dart with the reversed one, parallel edges are paired in
+    // reversed order of appearance: edge added later between same nodes lies
+    // outside of earlier one, so it is the last at one end and the first at other
+    const std::size_t noDart = static_cast<std::size_t>(-1);
+    std::vector<std::size_t> reversedIndex(firstDart.back(), noDart);
+    {
+        std::unordered_map<DartKey, std::deque<std::size_t>, DartKeyHash> unpaired;
+        for (std::size_t v = 0; v < nodes.size(); ++v)
+        {
+            if (graph.isRemoved(v))
+            {
+                continue;
+            }
+            const auto &transitions = nodes[v].transitions();
+            for (std::size_t i = 0; i < transitions.size(); ++i)
+            {
+                const Transition &tr = transitions[i];
+                if (graph.isRemoved(tr.to))
+                {
+                    continue;
+                }
+                GroupElement inversed = tr.label.inversed();
+                auto reversed = unpaired.find(DartKey{tr.to, static_cast<nodeId_t>(v), &inversed});
+                if (reversed == unpaired.end() || reversed->second.empty())
+                {
+                    unpaired[DartKey{static_cast<nodeId_t>(v), tr.to, &tr.label}].push_back(i);
+                    continue;
+                }
+                std::size_t other = reversed->second.back();
+                reversed->second.pop_back();
+                reversedIndex[dartId(v, i)] = other;
+                reversedIndex[dartId(tr.to, other)] = i;
+            }
+        }
+    }
+
+    // Face continues from dart u -> v with transition preceding v -> u in v's list
+    FaceList faces;
+    std::vector<char> visited(firstDart.back(), false);
+    dart_t outerDart{diagramm.getTerminal(), 0};
+    if (!Node::isNonexistantNode(outerDart.first))
+    {
+        outerDart.second = nodes[outerDart.first].transitions().size() - 1;
+    }
+    for (std::size_t v = 0; v < nodes.size(); ++v)
+    {
+        if (graph.isRemoved(v))
+        {
+            continue;
+        }
+        for (std::size_t i = 0; i < nodes[v].transitions().size(); ++i)
+        {
+            if (visited[dartId(v, i)] || reversedIndex[dartId(v, i)] == noDart)
+            {
+                continue;
+            }
+            dart_t dart{static_cast<nodeId_t>(v), i};
+            while (!visited[dartId(dart.first, dart.second)])
+            {
+                visited[dartId(dart.first, dart.second)] = true;
+                faces.darts.push_back(dart);
+                if (dart == outerDart)
+                {
+                    faces.outerFace = faces.size();
+                }
+                nodeId_t to = nodes[dart.first].transitions()[dart.second].to;
+                std::size_t back = reversedIndex[dartId(dart.first, dart.second)];
+                if (back == noDart)
+                {
+                    break; // Graph is not consistent, edge has no pair
+                }
+                std::size_t degree = nodes[to].transitions().size();
+                dart = {to, (back + degree - 1) % degree};
+            }
+            faces.offsets.push_back(faces.darts.size());
+        }
+    }
+    return faces;
+}
+
+void printFaces(const Graph &graph, const FaceList &faces, std::ostream &os)
+{
+    os << "# " << faces.size() << " faces, outer face is " << faces.outerFace << "\n";
+    for (std::size_t face = 0; face < faces.size(); ++face)
+    {
+        for (std::size_t d = faces.offsets[face]; d < faces.offsets[face + 1]; ++d)
+        {
+            os << faces.darts[d].first << ' ';
+        }
+        os << '|';
+        for (std::size_t d = faces.offsets[face]; d < faces.offsets[face + 1]; ++d)
+        {
+            const GroupElement &label = graph.node(faces.darts[d].first).transitions()[faces.darts[d].second].label;
+            os << (d == faces.offsets[face] ? " " : "*") << label.name << (label.reversed ? "^(-1)" : "");
+        }
+        os << '\n';
+    }
+    os.flush();
+}
+} // namespace van_kampen
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <random>
+
+#include "Generation.hpp"
+#include "IterativeAlgorithm.hpp"
+#include "LargeFirstAlgorithm.hpp"
+#include "LookaheadAlgorithm.hpp"
+#include "MergingAlgorithm.hpp"
+#include "RelationAffinity.hpp"
+#include "ShardedAlgorithm.hpp"
+#include "Utility.hpp"
+
+namespace van_kampen
+{
+std::string algorithmName(algorithmType algorithm)
+{
+    switch (algorithm)
+    {
+    case algorithmType::ITERATIVE:
+        return "iterative";
+    case algorithmType::LARGE_FIRST:
+        return "large-first";
+    case algorithmType::MERGING:
+        return "merging";
+    case algorithmType::SHARDED:
+        return "sharded";
+    case algorithmType::LOOKAHEAD:
+        return "lookahead";
+    }
+    throw std::invalid_argument("unknown algorithm");
+}
+
+std::string describeParameters(const GenerationParameters &parameters)
+{
+    // Only parameters read by selected algorithm, see makeAlgorithm, so
+    // equal runs get equal description for any threads count
+    std::string description = "algorithm=" + algorithmName(parameters.algorithm) +
+                              ";limit=" + std::to_string(parameters.cellsLimit);
+    switch (parameters.algorithm)
+    {
+    case algorithmType::ITERATIVE:
+        description += ";scheduled=" + std::to_string(parameters.scheduled);
+        break;
+    case algorithmType::LARGE_FIRST:
+        description += ";per-large=" + std::to_string(parameters.perLarge);
+        break;
+    case algorithmType::SHARDED:
+        description += ";shards=" + std::to_string(parameters.shards);
+        break;
+    case algorithmType::LOOKAHEAD:
+        description += ";lookahead=" + std::to_string(parameters.lookaheadWidth) + "x" +
+                       std::to_string(parameters.lookaheadDepth);
+        break;
+    case algorithmType::MERGING:
+        break;
+    }
+    return description;
+}
+
+void prepareWords(std::vector<std::vector<GroupElement>> &words, const GenerationParameters &parameters)
+{
+    if (words.empty())
+    {
+        throw std::invalid_argument("representation has no relations");
+    }
+    auto hub = words.back();
+    words.pop_back();
+    if (parameters.shuffle)
+    {
+        std::shuffle(words.begin(), words.end(), std::mt19937_64(parameters.seed));
+    }
+    if (parameters.sort)
+    {
+        std::stable_sort(words.begin(),
+                         words.end(),
+                         [](const std::vector<GroupElement> &a, const std::vector<GroupElement> &b) {
+                             return a.size() < b.size();
+                         });
+    }
+    words.push_back(hub);
+    if (parameters.affinity)
+    {
+        orderByAffinity(words, parameters.affinityK, parameters.threads ? parameters.threads : utility::defaultThreadsCount());
+    }
+}
+
+std::unique_ptr<DiagrammGeneratingAlgorithm> makeAlgorithm(const GenerationParameters &parameters)
+{
+    switch (parameters.algorithm)
+    {
+    case algorithmType::ITERATIVE:
+    {
+        auto iterative = std::make_unique<IterativeAlgorithm>();
+        iterative->cellsLimit = parameters.cellsLimit;
+        iterative->quiet = parameters.quiet;
+        iterative->scheduled = parameters.scheduled;
+        iterative->threads = parameters.threads;
+        return iterative;
+    }
+    case algorithmType::MERGING:
+    {
+        auto merging = std::make_unique<MergingAlgorithm>();
+        merging->limit = parameters.cellsLimit;
+        merging->quiet = parameters.quiet;
+        return merging;
+    }
+    case algorithmType::LARGE_FIRST:
+    {
+        auto largeFirst = std::make_unique<LargeFirstAlgorithm>();
+        largeFirst->cellsLimit = parameters.cellsLimit;
+        largeFirst->quiet = parameters.quiet;
+        largeFirst->maximalSmallForOneBig = parameters.perLarge;
+        largeFirst->threads = parameters.threads;
+        return largeFirst;
+    }
+    case algorithmType::SHARDED:
+    {
+        auto sharded = std::make_unique<ShardedAlgorithm>();
+        sharded->cellsLimit = parameters.cellsLimit;
+        sharded->quiet = parameters.quiet;
+        sharded->shards = parameters.shards;
+        sharded->threads = parameters.threads;
+        return sharded;
+    }
+    case algorithmType::LOOKAHEAD:
+    {
+        auto lookahead = std::make_unique<LookaheadAlgorithm>();
+        lookahead->cellsLimit = parameters.cellsLimit;
+        lookahead->quiet = parameters.quiet;
+        lookahead->width = parameters.lookaheadWidth;
+        lookahead->depth = parameters.lookaheadDepth;
+        lookahead->threads = parameters.threads;
+        return lookahead;
+    }
+    }
+    throw std::invalid_argument("unknown algorithm");
+}
+
+std::string circuitToString(const std::vector<Transition> &circuit)
+{
+    std::string result;
+    for (std::size_t i = 0; i < circuit.size(); ++i)
+    {
+        const GroupElement &letter = circuit[i].label;
+        result += letter.name + (letter.reversed ? "^(-1)" : "");
+        if (i < circuit.size() - 1)
+        {
+            result += "*";
+        }
+    }
+    return result;
+}
+} // namespace van_kampen
@@ -1,4 +1,9 @@
+#include <cstring>
+#include <unordered_map>
+
+#include "EventLog.hpp"
 #include "Graph.hpp"
+#include "SvgRenderer.hpp"
 #include "Utility.hpp"
 
 namespace van_kampen
@@ -8,14 +13,29 @@ Node::Node(Graph &g)
 
 void Node::addTransition(nodeId_t to, const GroupElement &label, bool inSquare, bool isHub)
 {
-    transitions_.push_back(Transition{to, label, inSquare, 0.0, isHub});
+    addTransition(Transition{to, label, inSquare, 0.0, isHub});
 }
 
 void Node::addTransition(Transition &&tr)
 {
+    if (EventLog *log = graph_.eventLog())
+    {
+        log->addTransition(id_, tr, false);
+    }
+    graph_.logUndo(Graph::undoType::POP_BACK, id_);
     transitions_.push_back(std::move(tr));
 }
 
+void Node::addFrontTransition(nodeId_t to, const GroupElement &label, bool inSquare, bool isHub)
+{
+    graph_.logUndo(Graph::undoType::POP_FRONT, id_);
+    transitions_.push_front(Transition{to, label, inSquare, 0.0, isHub});
+    if (EventLog *log = graph_.eventLog())
+    {
+        log->addTransition(id_, transitions_.front(), true);
+    }
+}
+
 nodeId_t Node::addTransitionToNewNode(const GroupElement &label, bool inSquare, bool isHub)
 {
     nodeId_t node = graph_.addNode();
@@ -29,17 +49,25 @@ void Node::swapLastAdditions()
     {
         throw std::length_error("unable to swap last two");
     }
+    if (EventLog *log = graph_.eventLog())
+    {
+        log->swapLastAdditions(id_);
+    }
+    graph_.logUndo(Graph::undoType::SWAP_LAST, id_);
     std::swap(transitions_[transitions_.size() - 2], transitions_[transitions_.size() - 1]);
 }
 
 void Node::highlightNode(bool value) noexcept { isHighlighted_ = value; }
+bool Node::isHighlighted() const noexcept { return isHighlighted_; }
 nodeId_t Node::getId() const noexcept { return id_; }
 void Node::setDiagramLabel(const std::string &label) { label_ = label; }
 void Node::setDiagramComment(const std::string &comment) { comment_ = comment; }
 void Node::setDiagramLabel(std::string &&label) { label_ = std::move(label); }
 void Node::setDiagramComment(std::string &&comment) { comment_ = std::move(comment); }
-const std::deque<Transition> &Node::transitions() const { return transitions_; }
-std::deque<Transition> &Node::transitions() { return transitions_; }
+const std::string &Node::diagramLabel() const noexcept { return label_; }
+const std::string &Node::diagramComment() const noexcept { return comment_; }
+const transitionList_t &Node::transitions() const { return transitions_; }
+transitionList_t &Node::transitions() { return transitions_; }
 nodeId_t Node::makeNonexistantNode() noexcept { return -1; }
 bool Node::isNonexistantNode(nodeId_t id) noexcept { return id == -1; }
 
@@ -52,6 +80,11 @@ void Node::printSelf(std::ostream &os, graphOutputFormat fmt) const
         std::string shape = std::string{"shape="} + (isHighlighted_ ? "circle" : "point");
         std::string label = !label_.empty() ? ",label=" + label_ : "";
         std::string comment = !comment_.empty() ? ",xlabel=\"" + comment_ + "\"" : "";
+        if (graph_.isPositioned())
+        {
+            utility::print(os, id_, "[", shape, label, comment, ",pos=\"", position.x, ",", position.y, "!\"];\n");
+            break;
+        }
         utility::print(os, id_, "[", shape, label, comment, "];\n");
         break;
     }
@@ -99,34 +132,28 @@ void Node::printTransitions(std::ostream &os, graphOutputFormat fmt, bool last)
 
 nodeId_t Graph::addNode()
 {
+    if (eventLog_)
+    {
+        eventLog_->addNode();
+    }
+    logUndo(undoType::POP_NODE, nodes_.size());
     nodes_.push_back(Node{*this});
     return nodes_.back().getId();
 }
 
-void Graph::increaseDirEdgePriority(nodeId_t from, nodeId_t to, double value)
+void Graph::printSelf(std::ostream &os, graphOutputFormat fmt) const
 {
-    for (Transition &tr : node(from).transitions())
+    if (fmt == graphOutputFormat::SVG)
     {
-        if (tr.to == to)
-        {
-            tr.priority += value;
-            return;
-        }
+        printSvg(*this, os);
+        return;
+    }
+    if (fmt == graphOutputFormat::BINARY)
+    {
+        writeBinary(os);
+        return;
     }
-    throw std::invalid_argument("can not increase priority of edge " +
-                                std::to_string(from) + " -> " +
-                                std::to_string(to) +
-                                ": it does not exist");
-}
-
-void Graph::increaseNondirEdgePriority(nodeId_t a, nodeId_t b, double value)
-{
-    increaseDirEdgePriority(a, b, value);
-    increaseDirEdgePriority(b, a, value);
-}
 
-void Graph::printSelf(std::ostream &os, graphOutputFormat fmt) const
-{
     switch (fmt)
     {
     case graphOutputFormat::DOT:
@@ -191,41 +218,324 @@ const Node &Graph::node(nodeId_t id) const
     return nodes_.at(id);
 }
 
-const std::deque<Node> &Graph::nodes() const
+const std::deque<Node, StorageAllocator<Node>> &Graph::nodes() const
 {
     return nodes_;
 }
 
 void Graph::mergeNodes(nodeId_t alive, nodeId_t dead, const std::unordered_set<nodeId_t> &untouchable)
 {
+    if (eventLog_)
+    {
+        eventLog_->mergeNodes(alive, dead, untouchable);
+    }
     for (Transition &edgeFromDead : node(dead).transitions())
     {
         if (untouchable.count(edgeFromDead.to))
         {
             continue;
         }
-        node(alive).addTransition(edgeFromDead.to, edgeFromDead.label, false, false); // TODO
-        for (Transition &edge : node(edgeFromDead.to).transitions())
+        logUndo(undoType::POP_BACK, alive);
+        node(alive).transitions_.push_back(Transition{edgeFromDead.to, edgeFromDead.label, false, 0.0, false}); // TODO
+        auto &neighbour = node(edgeFromDead.to).transitions_;
+        for (std::size_t i = 0; i < neighbour.size(); ++i)
         {
-            if (edge.to == dead)
+            if (neighbour[i].to == dead)
             {
-                edge.to = alive;
+                logUndo(undoType::SET_TARGET, edgeFromDead.to, dead, i);
+                neighbour[i].to = alive;
             }
         }
     }
-    removedNodes_.insert(dead);
+    if (removedNodes_.insert(dead).second)
+    {
+        logUndo(undoType::RESTORE_NODE, dead);
+    }
 }
 
 void Graph::removeOrientedEdge(nodeId_t a, nodeId_t b)
 {
+    if (eventLog_)
+    {
+        eventLog_->removeOrientedEdge(a, b);
+    }
     auto maybeRemove = [this](nodeId_t x, nodeId_t y) {
         std::size_t id = 0;
         for (; id < node(x).transitions().size() && node(x).transitions()[id].to != y; ++id)
             ;
         if (id < node(x).transitions().size())
+        {
+            logUndo(undoType::INSERT, x, node(x).transitions_[id], id);
             node(x).transitions_.erase(node(x).transitions_.begin() + id);
+        }
     };
     maybeRemove(a, b);
     maybeRemove(b, a);
 }
+
+void Graph::beginTransaction()
+{
+    if (eventLog_)
+    {
+        throw std::logic_error("transaction can not be started while graph changes are logged");
+    }
+    savepoints_.emplace_back(undoLog_.size(), savedTransitions_.size());
+}
+
+void Graph::commitTransaction()
+{
+    if (savepoints_.empty())
+    {
+        throw std::logic_error("no transaction to commit");
+    }
+    savepoints_.pop_back();
+    if (savepoints_.empty())
+    {
+        undoLog_.clear();
+        savedTransitions_.clear();
+    }
+}
+
+void Graph::rollbackTransaction()
+{
+    if (savepoints_.empty())
+    {
+        throw std::logic_error("no transaction to roll back");
+    }
+    auto [logSize, savedSize] = savepoints_.back();
+    savepoints_.pop_back();
+    while (undoLog_.size() > logSize)
+    {
+        const UndoRecord &record = undoLog_.back();
+        if (record.type == undoType::POP_NODE)
+        {
+            nodes_.pop_back();
+            undoLog_.pop_back();
+            continue;
+        }
+        auto &transitions = nodes_[record.node].transitions_;
+        switch (record.type)
+        {
+        case undoType::POP_BACK:
+            transitions.pop_back();
+            break;
+        case undoType::POP_FRONT:
+            transitions.pop_front();
+            break;
+        case undoType::SWAP_LAST:
+            std::swap(transitions[transitions.size() - 2], transitions[transitions.size() - 1]);
+            break;
+        case undoType::SET_TARGET:
+            transitions[record.index].to = record.value;
+            break;
+        case undoType::INSERT:
+            transitions.insert(transitions.begin() + record.index, std::move(savedTransitions_[record.value]));
+            break;
+        case undoType::RESTORE_NODE:
+            removedNodes_.erase(record.node);
+            break;
+        case undoType::POP_NODE:
+            break;
+        }
+        undoLog_.pop_back();
+    }
+    savedTransitions_.erase(savedTransitions_.begin() + savedSize, savedTransitions_.end());
+}
+
+bool Graph::inTransaction() const noexcept { return !savepoints_.empty(); }
+
+void Graph::logUndo(undoType type, nodeId_t node, nodeId_t value, std::size_t index)
+{
+    if (!savepoints_.empty())
+    {
+        undoLog_.push_back(UndoRecord{type, node, value, index});
+    }
+}
+
+void Graph::logUndo(undoType type, nodeId_t node, const Transition &saved, std::size_t index)
+{
+    if (!savepoints_.empty())
+    {
+        undoLog_.push_back(UndoRecord{type, node, static_cast<nodeId_t>(savedTransitions_.size()), index});
+        savedTransitions_.push_back(saved);
+    }
+}
+
+void Graph::setPositioned(bool value) noexcept { positioned_ = value; }
+bool Graph::isPositioned() const noexcept { return positioned_; }
+void Graph::setEventLog(EventLog *log) noexcept { eventLog_ = log; }
+EventLog *Graph::eventLog() const noexcept { return eventLog_; }
+
+bool Graph::isRemoved(nodeId_t id) const
+{
+    return removedNodes_.count(id);
+}
+
+std::vector<nodeId_t> Graph::compact(const std::vector<nodeId_t> &order)
+{
+    if (eventLog_)
+    {
+        throw std::logic_error("graph can not be compacted while its changes are logged");
+    }
+    if (inTransaction())
+    {
+        throw std::logic_error("graph can not be compacted in transaction");
+    }
+    std::vector<nodeId_t> newIds(nodes_.size(), Node::makeNonexistantNode());
+    auto exists = [&](nodeId_t v) {
+        return v >= 0 && static_cast<std::size_t>(v) < nodes_.size() && !isRemoved(v);
+    };
+    for (std::size_t i = 0; i < order.size(); ++i)
+    {
+        if (!exists(order[i]) || !Node::isNonexistantNode(newIds[order[i]]))
+        {
+            throw std::invalid_argument("compaction order must list every node once");
+        }
+        newIds[order[i]] = i;
+    }
+    if (order.size() + removedNodes_.size() != nodes_.size())
+    {
+        throw std::invalid_argument("compaction order must list every node once");
+    }
+
+    // Nodes are added anew, so that their ids are positions in order
+    auto old = std::move(nodes_);
+    nodes_.clear();
+    for (nodeId_t id : order)
+    {
+        Node &from = old[id];
+        nodes_.push_back(Node{*this});
+        Node &to = nodes_.back();
+        to.position = from.position;
+        to.isHighlighted_ = from.isHighlighted_;
+        to.label_ = std::move(from.label_);
+        to.comment_ = std::move(from.comment_);
+        to.transitions_ = std::move(from.transitions_);
+        auto stale = [&](const Transition &tr) {
+            return tr.to < 0 || static_cast<std::size_t>(tr.to) >= newIds.size() || Node::isNonexistantNode(newIds[tr.to]);
+        };
+        to.transitions_.erase(std::remove_if(to.transitions_.begin(), to.transitions_.end(), stale), to.transitions_.end());
+        for (Transition &tr : to.transitions_)
+        {
+            tr.to = newIds[tr.to];
+        }
+    }
+    removedNodes_.clear();
+    return newIds;
+}
+
+namespace
+{
+const char binaryMagic[] = "VKGRAPH1";
+
+enum binaryFlags : std::uint8_t
+{
+    NODE_HIGHLIGHTED = 1,
+    NODE_REMOVED = 2,
+    LABEL_REVERSED = 1,
+    EDGE_IN_SQUARE = 2,
+    EDGE_IN_HUB = 4,
+};
+} // namespace
+
+void Graph::writeBinary(std::ostream &os) const
+{
+    std::unordered_map<std::string, std::uint32_t> labelIds;
+    std::vector<const std::string *> labels;
+    for (const Node &node : nodes_)
+    {
+        for (const Transition &tr : node.transitions_)
+        {
+            if (labelIds.emplace(tr.label.name, labels.size()).second)
+            {
+                labels.push_back(&tr.label.name);
+            }
+        }
+    }
+
+    os.write(binaryMagic, sizeof(binaryMagic) - 1);
+    utility::writeRaw(os, static_cast<std::uint64_t>(nodes_.size()));
+    utility::writeRaw(os, static_cast<std::uint8_t>(positioned_));
+    utility::writeRaw(os, static_cast<std::uint32_t>(labels.size()));
+    for (const std::string *label : labels)
+    {
+        utility::writeRaw(os, *label);
+    }
+    for (const Node &node : nodes_)
+    {
+        std::uint8_t flags = (node.isHighlighted_ ? NODE_HIGHLIGHTED : 0) |
+                             (isRemoved(node.id_) ? NODE_REMOVED : 0);
+        utility::writeRaw(os, flags);
+        utility::writeRaw(os, node.label_);
+        utility::writeRaw(os, node.comment_);
+        utility::writeRaw(os, node.position);
+        utility::writeRaw(os, static_cast<std::uint32_t>(node.transitions_.size()));
+        for (const Transition &tr : node.transitions_)
+        {
+            std::uint8_t edgeFlags = (tr.label.reversed ? LABEL_REVERSED : 0) |
+                                     (tr.isInSquare ? EDGE_IN_SQUARE : 0) |
+                                     (tr.isInHub ? EDGE_IN_HUB : 0);
+            utility::writeRaw(os, static_cast<std::int64_t>(tr.to));
+            utility::writeRaw(os, labelIds[tr.label.name]);
+            utility::writeRaw(os, edgeFlags);
+            utility::writeRaw(os, tr.priority);
+        }
+    }
+    os.flush();
+}
+
+void Graph::readBinary(std::istream &is)
+{
+    if (!nodes_.empty())
+    {
+        throw std::logic_error("can not read binary graph into non-empty graph");
+    }
+    if (inTransaction())
+    {
+        throw std::logic_error("can not read binary graph in transaction");
+    }
+    char magic[sizeof(binaryMagic) - 1];
+    is.read(magic, sizeof(magic));
+    if (!is || std::memcmp(magic, binaryMagic, sizeof(magic)) != 0)
+    {
+        throw std::invalid_argument("binary graph has invalid header");
+    }
+    auto nodesCount = utility::readRaw<std::uint64_t>(is);
+    positioned_ = utility::readRaw<std::uint8_t>(is);
+    std::vector<std::string> labels(utility::readRaw<std::uint32_t>(is));
+    for (std::string &label : labels)
+    {
+        label = utility::readRaw<std::string>(is);
+    }
+    for (std::uint64_t i = 0; i < nodesCount; ++i)
+    {
+        Node &node = this->node(addNode());
+        auto flags = utility::readRaw<std::uint8_t>(is);
+        node.isHighlighted_ = flags & NODE_HIGHLIGHTED;
+        if (flags & NODE_REMOVED)
+        {
+            removedNodes_.insert(node.id_);
+        }
+        node.label_ = utility::readRaw<std::string>(is);
+        node.comment_ = utility::readRaw<std::string>(is);
+        node.position = utility::readRaw<Point>(is);
+        auto transitionsCount = utility::readRaw<std::uint32_t>(is);
+        for (std::uint32_t j = 0; j < transitionsCount; ++j)
+        {
+            auto to = utility::readRaw<std::int64_t>(is);
+            auto labelId = utility::readRaw<std::uint32_t>(is);
+            auto edgeFlags = utility::readRaw<std::uint8_t>(is);
+            auto priority = utility::readRaw<double>(is);
+            if (to < 0 || static_cast<std::uint64_t>(to) >= nodesCount || labelId >= labels.size())
+            {
+                throw std::invalid_argument("binary graph is corrupted");
+            }
+            node.transitions_.push_back(Transition{static_cast<nodeId_t>(to),
+                                                   GroupElement{labels[labelId], static_cast<bool>(edgeFlags & LABEL_REVERSED)},
+                                                   static_cast<bool>(edgeFlags & EDGE_IN_SQUARE),
+                                                   priority,
+                                                   static_cast<bool>(edgeFlags & EDGE_IN_HUB)});
+        }
+    }
+}
 } // namespace van_kampen
@@ -0,0 +1,474 @@
+#include <cmath>
+#include <numeric>
+#include <queue>
+#include <random>
+
+#include "GraphPartitioner.hpp"
+#include "Utility.hpp"
+
+namespace van_kampen
+{
+namespace
+{
+// Edges out of every cell have priority at least this, so cut is never free
+const double minEdgeWeight = 0.01;
+
+// Nondirected weighted graph of one coarsening level
+struct Level
+{
+    std::size_t size() const noexcept { return nodeWeight.size(); }
+
+    std::vector<std::size_t> offsets = {0}; // Node v neighbours are adjacent[offsets[v]..offsets[v + 1])
+    std::vector<std::size_t> adjacent;
+    std::vector<double> edgeWeight;
+    std::vector<std::size_t> nodeWeight;
+    std::vector<std::size_t> coarse; // Node of next level this node is contracted to
+};
+
+// Append neighbours accumulated in row to level, parallel edges are joined
+struct RowBuilder
+{
+    explicit RowBuilder(std::size_t size)
+        : slot(size, npos) {}
+
+    void add(std::size_t to, double weight)
+    {
+        if (slot[to] == npos)
+        {
+            slot[to] = row.size();
+            row.emplace_back(to, weight);
+        }
+        else
+        {
+            row[slot[to]].second += weight;
+        }
+    }
+
+    void flush(Level &level)
+    {
+        for (const auto &[to, weight] : row)
+        {
+            level.adjacent.push_back(to);
+            level.edgeWeight.push_back(weight);
+            slot[to] = npos;
+        }
+        level.offsets.push_back(level.adjacent.size());
+        row.clear();
+    }
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+    std::vector<std::size_t> slot;
+    std::vector<std::pair<std::size_t, double>> row;
+};
+
+// Level of diagram graph without removed nodes, local ids keep node order
+Level makeLevel(const Graph &graph, std::vector<std::size_t> &local)
+{
+    local.assign(graph.nodes().size(), RowBuilder::npos);
+    std::size_t count = 0;
+    for (const Node &node : graph.nodes())
+    {
+        if (!graph.isRemoved(node.getId()))
+        {
+            local[node.getId()] = count++;
+        }
+    }
+    Level level;
+    level.nodeWeight.assign(count, 1);
+    RowBuilder builder(count);
+    for (const Node &node : graph.nodes())
+    {
+        std::size_t v = local[node.getId()];
+        if (v == RowBuilder::npos)
+        {
+            continue;
+        }
+        for (const Transition &tr : node.transitions())
+        {
+            std::size_t to = local[tr.to];
+            if (to != RowBuilder::npos && to != v)
+            {
+                builder.add(to, tr.priority + minEdgeWeight);
+            }
+        }
+        builder.flush(level);
+    }
+    return level;
+}
+
+// Match every node with unmatched neighbour along heaviest edge and contract
+// matched pairs; coarse node weight is kept under maxNodeWeight
+Level coarsen(Level &fine, std::size_t maxNodeWeight, std::mt19937 &random)
+{
+    std::size_t n = fine.size();
+    std::vector<std::size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), random);
+
+    std::vector<std::size_t> match(n, RowBuilder::npos);
+    for (std::size_t v : order)
+    {
+        if (match[v] != RowBuilder::npos)
+        {
+            continue;
+        }
+        std::size_t best = v;
+        double bestWeight = -1.0;
+        for (std::size_t i = fine.offsets[v]; i < fine.offsets[v + 1]; ++i)
+        {
+            std::size_t u = fine.adjacent[i];
+            if (match[u] == RowBuilder::npos && fine.edgeWeight[i] > bestWeight &&
+                fine.nodeWeight[u] + fine.nodeWeight[v] <= maxNodeWeight)
+            {
+                best = u;
+                bestWeight = fine.edgeWeight[i];
+            }
+        }
+        match[v] = best;
+        match[best] = v;
+    }
+
+    fine.coarse.assign(n, RowBuilder::npos);
+    Level level;
+    for (std::size_t v = 0; v < n; ++v)
+    {
+        if (fine.coarse[v] == RowBuilder::npos)
+        {
+            fine.coarse[v] = fine.coarse[match[v]] = level.nodeWeight.size();
+            level.nodeWeight.push_back(fine.nodeWeight[v] + (match[v] != v ? fine.nodeWeight[match[v]] : 0));
+        }
+    }
+    std::vector<std::size_t> first(level.size(), RowBuilder::npos);
+    for (std::size_t v = n; v-- > 0;)
+    {
+        first[fine.coarse[v]] = v;
+    }
+    RowBuilder builder(level.size());
+    for (std::size_t c = 0; c < level.size(); ++c)
+    {
+        std::size_t v = first[c];
+        for (std::size_t member : {v, match[v]})
+        {
+            for (std::size_t i = fine.offsets[member]; i < fine.offsets[member + 1]; ++i)
+            {
+                std::size_t to = fine.coarse[fine.adjacent[i]];
+                if (to != c)
+                {
+                    builder.add(to, fine.edgeWeight[i]);
+                }
+            }
+            if (match[v] == v)
+            {
+                break;
+            }
+        }
+        builder.flush(level);
+    }
+    return level;
+}
+
+// Grow parts one after another from seeds in breadth first order, adding
+// frontier node most connected to part; the last part takes the rest
+std::vector<std::size_t> growParts(const Level &level, std::size_t parts)
+{
+    std::size_t n = level.size();
+    std::vector<std::size_t> bfsOrder;
+    bfsOrder.reserve(n);
+    std::vector<char> visited(n, false);
+    for (std::size_t root = 0; root < n; ++root)
+    {
+        if (visited[root])
+        {
+            continue;
+        }
+        visited[root] = true;
+        bfsOrder.push_back(root);
+        for (std::size_t head = bfsOrder.size() - 1; head < bfsOrder.size(); ++head)
+        {
+            std::size_t v = bfsOrder[head];
+            for (std::size_t i = level.offsets[v]; i < level.offsets[v + 1]; ++i)
+            {
+                if (!visited[level.adjacent[i]])
+                {
+                    visited[level.adjacent[i]] = true;
+                    bfsOrder.push_back(level.adjacent[i]);
+                }
+            }
+        }
+    }
+
+    std::vector<std::size_t> part(n, parts);
+    std::size_t left = std::accumulate(level.nodeWeight.begin(), level.nodeWeight.end(), std::size_t{0});
+    std::size_t seedCursor = 0;
+    std::vector<double> connection(n, 0.0);
+    for (std::size_t p = 0; p + 1 < parts; ++p)
+    {
+        std::size_t target = left / (parts - p);
+        std::size_t weight = 0;
+        std::fill(connection.begin(), connection.end(), 0.0);
+        std::priority_queue<std::pair<double, std::size_t>> frontier;
+        while (weight < target)
+        {
+            std::size_t v = RowBuilder::npos;
+            while (!frontier.empty() && v == RowBuilder::npos)
+            {
+                auto [gain, u] = frontier.top();
+                frontier.pop();
+                if (part[u] == parts && gain == connection[u])
+                {
+                    v = u;
+                }
+            }
+            if (v == RowBuilder::npos)
+            {
+                while (seedCursor < n && part[bfsOrder[seedCursor]] != parts)
+                {
+                    ++seedCursor;
+                }
+                if (seedCursor == n)
+                {
+                    break;
+                }
+                v = bfsOrder[seedCursor];
+            }
+            if (weight > 0 && weight + level.nodeWeight[v] > target + level.nodeWeight[v] / 2)
+            {
+                break;
+            }
+            part[v] = p;
+            weight += level.nodeWeight[v];
+            for (std::size_t i = level.offsets[v]; i < level.offsets[v + 1]; ++i)
+            {
+                std::size_t u = level.adjacent[i];
+                if (part[u] == parts)
+                {
+                    connection[u] += level.edgeWeight[i];
+                    frontier.emplace(connection[u], u);
+                }
+            }
+        }
+        left -= weight;
+    }
+    for (std::size_t &p : part)
+    {
+        if (p == parts)
+        {
+            p = parts - 1;
+        }
+    }
+    return part;
+}
+
+// Move nodes to the neighbouring part they are most connected to while cut
+// decreases or balance improves, overloaded parts give nodes away anyway
+void refine(const Level &level, std::vector<std::size_t> &part, std::size_t parts, std::size_t maxPartWeight, std::size_t passes)
+{
+    std::vector<std::size_t> partWeight(parts, 0);
+    for (std::size_t v = 0; v < level.size(); ++v)
+    {
+        partWeight[part[v]] += level.nodeWeight[v];
+    }
+    std::vector<double> connection(parts, 0.0);
+    std::vector<std::size_t> touched;
+    for (std::size_t pass = 0; pass < passes; ++pass)
+    {
+        std::size_t moves = 0;
+        for (std::size_t v = 0; v < level.size(); ++v)
+        {
+            std::size_t from = part[v];
+            std::size_t weight = level.nodeWeight[v];
+            bool boundary = false;
+            for (std::size_t i = level.offsets[v]; i < level.offsets[v + 1]; ++i)
+            {
+                std::size_t p = part[level.adjacent[i]];
+                if (connection[p] == 0.0)
+                {
+                    touched.push_back(p);
+                }
+                connection[p] += level.edgeWeight[i];
+                boundary |= p != from;
+            }
+            if (boundary && partWeight[from] > weight)
+            {
+                bool overloaded = partWeight[from] > maxPartWeight;
+                std::size_t best = from;
+                double bestGain = 0.0;
+                for (std::size_t to : touched)
+                {
+                    if (to == from || partWeight[to] + weight > maxPartWeight)
+                    {
+                        continue;
+                    }
+                    double gain = connection[to] - connection[from];
+                    bool better = best == from ? gain > 0.0 || overloaded || (gain == 0.0 && partWeight[to] + weight < partWeight[from])
+                                               : gain > bestGain;
+                    if (better)
+                    {
+                        best = to;
+                        bestGain = gain;
+                    }
+                }
+                if (best != from)
+                {
+                    part[v] = best;
+                    partWeight[from] -= weight;
+                    partWeight[best] += weight;
+                    ++moves;
+                }
+            }
+            for (std::size_t p : touched)
+            {
+                connection[p] = 0.0;
+            }
+            touched.clear();
+        }
+        if (moves == 0)
+        {
+            break;
+        }
+    }
+}
+} // namespace
+
+std::vector<std::size_t> partitionGraph(const Graph &graph, PartitionParameters parameters)
+{
+    std::vector<std::size_t> local;
+    std::deque<Level> levels;
+    levels.push_back(makeLevel(graph, local));
+    std::size_t n = levels.front().size();
+    std::size_t parts = parameters.parts ? parameters.parts : (n + parameters.partSize - 1) / std::max<std::size_t>(1, parameters.partSize);
+    parts = std::clamp<std::size_t>(parts, 1, std::max<std::size_t>(1, n));
+
+    std::vector<std::size_t> result(graph.nodes().size(), parts);
+    if (parts > 1)
+    {
+        std::size_t maxPartWeight = static_cast<std::size_t>(std::ceil((1.0 + parameters.imbalance) * n / parts));
+        std::size_t coarsestSize = std::max<std::size_t>(20 * parts, 100);
+        std::mt19937 random(parameters.seed);
+        while (levels.back().size() > coarsestSize)
+        {
+            Level next = coarsen(levels.back(), std::max<std::size_t>(1, n / (4 * parts)), random);
+            if (next.size() * 20 > levels.back().size() * 19)
+            {
+                break; // Matching does not shrink graph anymore
+            }
+            levels.push_back(std::move(next));
+        }
+
+        std::vector<std::size_t> part = growParts(levels.back(), parts);
+        refine(levels.back(), part, parts, maxPartWeight, parameters.refinePasses);
+        for (std::size_t l = levels.size() - 1; l-- > 0;)
+        {
+            const Level &fine = levels[l];
+            std::vector<std::size_t> projected(fine.size());
+            for (std::size_t v = 0; v < fine.size(); ++v)
+            {
+                projected[v] = part[fine.coarse[v]];
+            }
+            part = std::move(projected);
+            levels.pop_back();
+            refine(fine, part, parts, maxPartWeight, parameters.refinePasses);
+        }
+        for (std::size_t id = 0; id < local.size(); ++id)
+        {
+            if (local[id] != RowBuilder::npos)
+            {
+                result[id] = part[local[id]];
+            }
+        }
+    }
+    else
+    {
+        for (std::size_t id = 0; id < local.size(); ++id)
+        {
+            if (local[id] != RowBuilder::npos)
+            {
+                result[id] = 0;
+            }
+        }
+    }
+    return result;
+}
+
+Partition splitToParts(const Graph &graph, const std::vector<std::size_t> &part, std::size_t threads)
+{
+    std::size_t nodes = graph.nodes().size();
+    std::size_t parts = 0;
+    for (std::size_t id = 0; id < nodes; ++id)
+    {
+        if (!graph.isRemoved(id))
+        {
+            parts = std::max(parts, part[id] + 1);
+        }
+    }
+
+    Partition partition;
+    partition.globalIds.resize(parts);
+    std::vector<nodeId_t> local(nodes, Node::makeNonexistantNode());
+    for (std::size_t id = 0; id < nodes; ++id)
+    {
+        if (!graph.isRemoved(id))
+        {
+            local[id] = partition.globalIds[part[id]].size();
+            partition.globalIds[part[id]].push_back(id);
+        }
+    }
+    for (std::size_t p = 0; p < parts; ++p)
+    {
+        partition.parts.emplace_back();
+        partition.parts.back().setPositioned(graph.isPositioned());
+    }
+
+    std::vector<std::vector<CutEdge>> cut(parts);
+    utility::parallelFor(parts, threads, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t p = begin; p < end; ++p)
+        {
+            Graph &component = partition.parts[p];
+            for (nodeId_t id : partition.globalIds[p])
+            {
+                component.node(component.addNode()).position = graph.node(id).position;
+            }
+            for (nodeId_t id : partition.globalIds[p])
+            {
+                Node &node = component.node(local[id]);
+                bool boundary = false;
+                for (const Transition &tr : graph.node(id).transitions())
+                {
+                    if (graph.isRemoved(tr.to))
+                    {
+                        continue;
+                    }
+                    if (part[tr.to] == p)
+                    {
+                        node.addTransition(Transition{local[tr.to], tr.label, tr.isInSquare, tr.priority, tr.isInHub});
+                        continue;
+                    }
+                    boundary = true;
+                    if (!tr.label.reversed)
+                    {
+                        cut[p].push_back(CutEdge{p, part[tr.to], local[id], local[tr.to], tr.label});
+                    }
+                }
+                if (boundary)
+                {
+                    node.setDiagramComment(std::to_string(id));
+                }
+            }
+        }
+    });
+    for (auto &edges : cut)
+    {
+        partition.cut.insert(partition.cut.end(), edges.begin(), edges.end());
+    }
+    return partition;
+}
+
+void printCutEdges(const Partition &partition, std::ostream &os)
+{
+    for (const CutEdge &edge : partition.cut)
+    {
+        os << edge.fromPart + 1 << ' ' << edge.from << ' ' << edge.toPart + 1 << ' ' << edge.to << ' ' << edge.label.name << '\n';
+    }
+    os.flush();
+}
+} // namespace van_kampen
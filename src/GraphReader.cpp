@@ -0,0 +1,383 @@
+#include <charconv>
+#include <cstdlib>
+#include <numeric>
+#include <string_view>
+
+#include "Graph.hpp"
+#include "Utility.hpp"
+
+namespace van_kampen
+{
+namespace
+{
+struct ParsedEdge
+{
+    nodeId_t from, to;
+    std::string label;
+    bool inHub = false;
+};
+
+struct ParsedNode
+{
+    nodeId_t id;
+    bool highlighted = false;
+    bool positioned = false;
+    std::string label, comment;
+    Point position;
+};
+
+// Lines of one part of text, in order
+struct ParsedChunk
+{
+    std::vector<ParsedEdge> edges;
+    std::vector<ParsedNode> nodes;
+    nodeId_t maxId = -1;
+};
+
+// Indices of chunk edges and nodes grouped by owner ranges of nodes in
+// chunk order: owner t has edges[edgeOffsets[t]..edgeOffsets[t + 1]), an edge
+// is listed for owners of both its ends
+struct ChunkBuckets
+{
+    std::vector<std::size_t> edgeOffsets, edges, nodeOffsets, nodes;
+
+    template <typename Owner>
+    void fill(const ParsedChunk &chunk, std::size_t owners, Owner &&ownerOf)
+    {
+        edgeOffsets.assign(owners + 1, 0);
+        nodeOffsets.assign(owners + 1, 0);
+        auto forEdgeOwners = [&](const ParsedEdge &edge, auto &&f) {
+            std::size_t from = ownerOf(edge.from), to = ownerOf(edge.to);
+            f(from);
+            if (to != from)
+            {
+                f(to);
+            }
+        };
+        // Counting sort: sizes, then starts, then stable placement
+        for (const ParsedEdge &edge : chunk.edges)
+        {
+            forEdgeOwners(edge, [&](std::size_t t) { ++edgeOffsets[t + 1]; });
+        }
+        for (const ParsedNode &node : chunk.nodes)
+        {
+            ++nodeOffsets[ownerOf(node.id) + 1];
+        }
+        std::partial_sum(edgeOffsets.begin(), edgeOffsets.end(), edgeOffsets.begin());
+        std::partial_sum(nodeOffsets.begin(), nodeOffsets.end(), nodeOffsets.begin());
+        edges.resize(edgeOffsets.back());
+        nodes.resize(nodeOffsets.back());
+        std::vector<std::size_t> edgeNext(edgeOffsets.begin(), edgeOffsets.end() - 1);
+        std::vector<std::size_t> nodeNext(nodeOffsets.begin(), nodeOffsets.end() - 1);
+        for (std::size_t e = 0; e < chunk.edges.size(); ++e)
+        {
+            forEdgeOwners(chunk.edges[e], [&](std::size_t t) { edges[edgeNext[t]++] = e; });
+        }
+        for (std::size_t n = 0; n < chunk.nodes.size(); ++n)
+        {
+            nodes[nodeNext[ownerOf(chunk.nodes[n].id)]++] = n;
+        }
+    }
+};
+
+[[noreturn]] void invalidLine(std::string_view line)
+{
+    throw std::invalid_argument("invalid diagram line '" + std::string(line) + "'");
+}
+
+void skipSpaces(std::string_view &s)
+{
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+    {
+        s.remove_prefix(1);
+    }
+}
+
+bool readId(std::string_view &s, nodeId_t &id)
+{
+    skipSpaces(s);
+    auto [end, error] = std::from_chars(s.data(), s.data() + s.size(), id);
+    if (error != std::errc{} || id < 0)
+    {
+        return false;
+    }
+    s.remove_prefix(end - s.data());
+    return true;
+}
+
+bool readPrefix(std::string_view &s, std::string_view prefix)
+{
+    skipSpaces(s);
+    if (s.substr(0, prefix.size()) != prefix)
+    {
+        return false;
+    }
+    s.remove_prefix(prefix.size());
+    return true;
+}
+
+// Call attribute(key, value) for every key=value or key="value" in [...]
+template <typename F>
+bool readAttributes(std::string_view s, F &&attribute)
+{
+    if (!readPrefix(s, "["))
+    {
+        return false;
+    }
+    while (true)
+    {
+        skipSpaces(s);
+        if (readPrefix(s, "]"))
+        {
+            return true;
+        }
+        std::size_t equals = s.find('=');
+        if (equals == std::string_view::npos)
+        {
+            return false;
+        }
+        std::string_view key = s.substr(0, equals), value;
+        s.remove_prefix(equals + 1);
+        if (readPrefix(s, "\""))
+        {
+            std::size_t quote = s.find('"');
+            if (quote == std::string_view::npos)
+            {
+                return false;
+            }
+            value = s.substr(0, quote);
+            s.remove_prefix(quote + 1);
+        }
+        else
+        {
+            std::size_t stop = s.find_first_of(",]");
+            if (stop == std::string_view::npos)
+            {
+                return false;
+            }
+            value = s.substr(0, stop);
+            s.remove_prefix(stop);
+        }
+        attribute(key, value);
+        readPrefix(s, ",");
+    }
+}
+
+// Lines are 'a b' for every edge a -> b
+void parseEdgesLine(std::string_view line, ParsedChunk &chunk)
+{
+    std::string_view rest = line;
+    ParsedEdge edge;
+    if (!readId(rest, edge.from) || !readId(rest, edge.to))
+    {
+        invalidLine(line);
+    }
+    skipSpaces(rest);
+    if (!rest.empty())
+    {
+        invalidLine(line);
+    }
+    chunk.maxId = std::max({chunk.maxId, edge.from, edge.to});
+    chunk.edges.push_back(std::move(edge));
+}
+
+// Lines are 'a->b [...]' for edges and 'a[...]' for nodes, graph attributes
+// and braces are skipped
+void parseDotLine(std::string_view line, ParsedChunk &chunk)
+{
+    std::string_view rest = line;
+    nodeId_t id;
+    if (!readId(rest, id))
+    {
+        return;
+    }
+    if (readPrefix(rest, "->"))
+    {
+        ParsedEdge edge;
+        edge.from = id;
+        bool ok = readId(rest, edge.to) && readAttributes(rest, [&](std::string_view key, std::string_view value) {
+            if (key == "label")
+            {
+                edge.label = value;
+            }
+            else if (key == "penwidth")
+            {
+                edge.inHub = value != "1";
+            }
+        });
+        if (!ok)
+        {
+            invalidLine(line);
+        }
+        chunk.maxId = std::max({chunk.maxId, edge.from, edge.to});
+        chunk.edges.push_back(std::move(edge));
+        return;
+    }
+    ParsedNode node;
+    node.id = id;
+    bool ok = readAttributes(rest, [&](std::string_view key, std::string_view value) {
+        if (key == "shape")
+        {
+            node.highlighted = value == "circle";
+        }
+        else if (key == "label")
+        {
+            node.label = value;
+        }
+        else if (key == "xlabel")
+        {
+            node.comment = value;
+        }
+        else if (key == "pos")
+        {
+            // 'x,y!'
+            std::string pos(value);
+            char *end = nullptr;
+            node.position.x = std::strtod(pos.c_str(), &end);
+            node.position.y = *end == ',' ? std::strtod(end + 1, nullptr) : 0.0;
+            node.positioned = true;
+        }
+    });
+    if (!ok)
+    {
+        invalidLine(line);
+    }
+    chunk.maxId = std::max(chunk.maxId, id);
+    chunk.nodes.push_back(std::move(node));
+}
+} // namespace
+
+void Graph::readText(const char *begin, const char *end, graphOutputFormat fmt, std::size_t threads)
+{
+    if (!nodes_.empty())
+    {
+        throw std::logic_error("can not read text graph into non-empty graph");
+    }
+    if (inTransaction() || eventLog_)
+    {
+        throw std::logic_error("can not read text graph with event log or in transaction");
+    }
+    if (fmt != graphOutputFormat::DOT && fmt != graphOutputFormat::TXT_EDGES)
+    {
+        throw std::invalid_argument("graph can be read from dot or edges text only");
+    }
+
+    // Text is cut into parts at line starts, each part is parsed by its thread
+    const std::size_t size = end - begin;
+    threads = std::max<std::size_t>(1, std::min(threads, size / 4096 + 1));
+    std::vector<const char *> starts(threads + 1, end);
+    for (std::size_t t = 0; t < threads; ++t)
+    {
+        const char *start = begin + size * t / threads;
+        if (t && start[-1] != '\n')
+        {
+            start = std::find(start, end, '\n');
+            start += start != end;
+        }
+        starts[t] = start;
+    }
+    std::vector<ParsedChunk> chunks(threads);
+    utility::parallelFor(threads, threads, [&](std::size_t first, std::size_t last, std::size_t) {
+        for (std::size_t t = first; t < last; ++t)
+        {
+            for (const char *line = starts[t]; line < starts[t + 1];)
+            {
+                const char *lineEnd = std::find(line, starts[t + 1], '\n');
+                std::string_view text(line, lineEnd - line);
+                if (!text.empty() && text.back() == '\r')
+                {
+                    text.remove_suffix(1);
+                }
+                if (fmt == graphOutputFormat::DOT)
+                {
+                    parseDotLine(text, chunks[t]);
+                }
+                else if (!text.empty())
+                {
+                    parseEdgesLine(text, chunks[t]);
+                }
+                line = lineEnd + 1;
+            }
+        }
+    });
+
+    nodeId_t maxId = -1;
+    for (const ParsedChunk &chunk : chunks)
+    {
+        maxId = std::max(maxId, chunk.maxId);
+    }
+    const std::size_t count = maxId + 1;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        nodes_.push_back(Node{*this});
+    }
+
+    // Nodes are split into owner ranges; edges and nodes of every chunk are
+    // bucketed by owners of their ends, keeping their order, so each owner
+    // walks only its buckets and transitions are ordered as edges for any
+    // threads count
+    const std::size_t owners = std::max<std::size_t>(1, std::min(threads, count));
+    std::vector<std::size_t> ownerStarts(owners + 1);
+    for (std::size_t t = 0; t <= owners; ++t)
+    {
+        ownerStarts[t] = count * t / owners;
+    }
+    auto ownerOf = [&](nodeId_t v) {
+        return static_cast<std::size_t>(std::upper_bound(ownerStarts.begin(), ownerStarts.end(), static_cast<std::size_t>(v)) -
+                                        ownerStarts.begin()) - 1;
+    };
+    std::vector<ChunkBuckets> buckets(chunks.size());
+    utility::parallelFor(chunks.size(), threads, [&](std::size_t first, std::size_t last, std::size_t) {
+        for (std::size_t c = first; c < last; ++c)
+        {
+            buckets[c].fill(chunks[c], owners, ownerOf);
+        }
+    });
+
+    std::vector<char> printed(count, false), positioned(owners, false);
+    utility::parallelFor(owners, owners, [&](std::size_t first, std::size_t last, std::size_t) {
+        for (std::size_t t = first; t < last; ++t)
+        {
+            for (std::size_t c = 0; c < chunks.size(); ++c)
+            {
+                const ParsedChunk &chunk = chunks[c];
+                const ChunkBuckets &bucket = buckets[c];
+                for (std::size_t k = bucket.nodeOffsets[t]; k < bucket.nodeOffsets[t + 1]; ++k)
+                {
+                    const ParsedNode &parsed = chunk.nodes[bucket.nodes[k]];
+                    Node &node = nodes_[parsed.id];
+                    node.isHighlighted_ = parsed.highlighted;
+                    node.label_ = parsed.label;
+                    node.comment_ = parsed.comment;
+                    node.position = parsed.position;
+                    printed[parsed.id] = true;
+                    positioned[t] = positioned[t] || parsed.positioned;
+                }
+                for (std::size_t k = bucket.edgeOffsets[t]; k < bucket.edgeOffsets[t + 1]; ++k)
+                {
+                    const ParsedEdge &edge = chunk.edges[bucket.edges[k]];
+                    GroupElement label{edge.label, false};
+                    if (ownerOf(edge.from) == t)
+                    {
+                        nodes_[edge.from].transitions_.push_back(Transition{edge.to, label, false, 0.0, edge.inHub});
+                        printed[edge.from] = true;
+                    }
+                    if (ownerOf(edge.to) == t)
+                    {
+                        nodes_[edge.to].transitions_.push_back(Transition{edge.from, label.inversed(), false, 0.0, edge.inHub});
+                        printed[edge.to] = true;
+                    }
+                }
+            }
+        }
+    });
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (!printed[i])
+        {
+            removedNodes_.insert(i);
+        }
+    }
+    positioned_ = std::find(positioned.begin(), positioned.end(), true) != positioned.end();
+}
+} // namespace van_kampen
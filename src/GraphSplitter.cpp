@@ -1,5 +0,0 @@
-#include "GraphSplitter.hpp"
-
-namespace van_kampen
-{
-} // namespace van_kampen
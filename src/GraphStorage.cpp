@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "GraphStorage.hpp"
+
+namespace van_kampen
+{
+namespace
+{
+const std::size_t blockAlignment = alignof(std::max_align_t);
+
+// File grows by segments of this size
+const std::size_t segmentBytes = std::size_t{256} << 20;
+
+struct Segment
+{
+    char *begin;
+    std::size_t size;
+};
+
+struct Storage
+{
+    std::atomic<std::size_t> limit{0};
+    std::atomic<std::size_t> heap{0};
+    std::atomic<bool> hasMapped{false};
+
+    // Guard everything below
+    std::mutex mutex;
+    std::string directory;
+    int file = -1;
+    std::size_t fileSize = 0;
+    std::size_t mapped = 0;
+    std::vector<Segment> segments; // Sorted by address
+    char *cursor = nullptr, *end = nullptr;
+    std::unordered_map<std::size_t, std::vector<void *>> freeBlocks; // By rounded size
+};
+
+// Never destroyed, so graphs of static objects may outlive it
+Storage &storage()
+{
+    static Storage *instance = new Storage;
+    return *instance;
+}
+
+std::size_t roundUp(std::size_t bytes, std::size_t alignment)
+{
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+
+void openFile(Storage &s)
+{
+    std::string directory = s.directory.empty() ? std::filesystem::temp_directory_path().string() : s.directory;
+    std::string path = (std::filesystem::path(directory) / "vankampen-graph-XXXXXX").string();
+    s.file = mkstemp(path.data());
+    if (s.file == -1)
+    {
+        throw std::runtime_error("cannot create graph storage file in '" + directory + "'");
+    }
+    unlink(path.c_str()); // File is deleted once closed
+}
+
+// Map new segment of file, large enough for block of given size
+void grow(Storage &s, std::size_t bytes)
+{
+    if (s.file == -1)
+    {
+        openFile(s);
+    }
+    std::size_t size = std::max(segmentBytes, roundUp(bytes, static_cast<std::size_t>(sysconf(_SC_PAGESIZE))));
+    if (ftruncate(s.file, static_cast<off_t>(s.fileSize + size)) != 0)
+    {
+        throw std::bad_alloc();
+    }
+    void *begin = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, s.file, static_cast<off_t>(s.fileSize));
+    if (begin == MAP_FAILED)
+    {
+        throw std::bad_alloc();
+    }
+    s.fileSize += size;
+    Segment segment{static_cast<char *>(begin), size};
+    s.segments.insert(std::upper_bound(s.segments.begin(), s.segments.end(), segment, [](const Segment &a, const Segment &b) {
+                          return a.begin < b.begin;
+                      }),
+                      segment);
+    s.cursor = segment.begin;
+    s.end = segment.begin + size;
+    s.hasMapped = true;
+}
+
+bool isMapped(const Storage &s, const void *block)
+{
+    auto it = std::upper_bound(s.segments.begin(), s.segments.end(), static_cast<const char *>(block), [](const char *p, const Segment &segment) {
+        return p < segment.begin;
+    });
+    return it != s.segments.begin() && static_cast<const char *>(block) < std::prev(it)->begin + std::prev(it)->size;
+}
+} // namespace
+
+void GraphStorage::setMemoryLimit(std::size_t bytes, const std::string &directory)
+{
+    Storage &s = storage();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.directory = directory;
+    s.limit = bytes;
+}
+
+void *GraphStorage::allocate(std::size_t bytes)
+{
+    Storage &s = storage();
+    std::size_t limit = s.limit.load(std::memory_order_relaxed);
+    if (limit == 0 || s.heap.load(std::memory_order_relaxed) + bytes <= limit)
+    {
+        void *block = ::operator new(bytes);
+        s.heap.fetch_add(bytes, std::memory_order_relaxed);
+        return block;
+    }
+
+    std::size_t rounded = roundUp(bytes, blockAlignment);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    void *block;
+    auto &freeBlocks = s.freeBlocks[rounded];
+    if (!freeBlocks.empty())
+    {
+        block = freeBlocks.back();
+        freeBlocks.pop_back();
+    }
+    else
+    {
+        if (static_cast<std::size_t>(s.end - s.cursor) < rounded)
+        {
+            grow(s, rounded);
+        }
+        block = s.cursor;
+        s.cursor += rounded;
+    }
+    s.mapped += rounded;
+    return block;
+}
+
+void GraphStorage::deallocate(void *block, std::size_t bytes) noexcept
+{
+    Storage &s = storage();
+    if (s.hasMapped.load(std::memory_order_acquire))
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        if (isMapped(s, block))
+        {
+            std::size_t rounded = roundUp(bytes, blockAlignment);
+            s.mapped -= rounded;
+            try
+            {
+                s.freeBlocks[rounded].push_back(block);
+            }
+            catch (...)
+            {
+                // Block is lost, file keeps its pages
+            }
+            return;
+        }
+    }
+    s.heap.fetch_sub(bytes, std::memory_order_relaxed);
+    ::operator delete(block);
+}
+
+std::size_t GraphStorage::heapBytes() noexcept
+{
+    return storage().heap.load(std::memory_order_relaxed);
+}
+
+std::size_t GraphStorage::mappedBytes() noexcept
+{
+    Storage &s = storage();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    return s.mapped;
+}
+} // namespace van_kampen
@@ -1,8 +1,176 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+#include "EventLog.hpp"
 #include "Group.hpp"
 #include "Graph.hpp"
+#include "Utility.hpp"
 
 namespace van_kampen
 {
+namespace
+{
+// Rotations times boundary letters from which matching is split between threads
+const std::size_t parallelMatchingWork = std::size_t{1} << 20;
+
+const std::uint32_t noLetter = static_cast<std::uint32_t>(-1);
+
+// Header of binary diagram, so loader does not take it for text
+const char diagramMagic[] = "VKDIAGR1";
+
+// Longest entries of word rotation into part of boundary, earliest of equal ones
+// Entry ends at given position of reversed boundary
+struct EntryCandidates
+{
+    std::size_t square = 0, squareEnd = 0; // Ending at edge which is in square
+    std::size_t any = 0, anyEnd = 0;
+
+    void add(const EntryCandidates &later)
+    {
+        if (later.square > square)
+        {
+            square = later.square;
+            squareEnd = later.squareEnd;
+        }
+        if (later.any > any)
+        {
+            any = later.any;
+            anyEnd = later.anyEnd;
+        }
+    }
+};
+
+// Knuth-Morris-Pratt scan of text[begin, end) for prefixes of pattern
+// Scan starts pattern length before begin, so entries crossing begin are found
+EntryCandidates scanEntries(const std::vector<std::uint32_t> &pattern,
+                            const std::vector<std::size_t> &prefix,
+                            const std::vector<std::uint32_t> &text,
+                            const std::vector<char> &inSquare,
+                            std::size_t begin,
+                            std::size_t end)
+{
+    EntryCandidates result;
+    std::size_t j = 0;
+    for (std::size_t i = begin - std::min(begin, pattern.size()); i < end; ++i)
+    {
+        if (j == pattern.size())
+        {
+            j = prefix[j - 1];
+        }
+        for (; j > 0 && text[i] != pattern[j]; j = prefix[j - 1])
+            ;
+        if (text[i] == pattern[j])
+        {
+            ++j;
+        }
+        if (i < begin)
+        {
+            continue;
+        }
+        if (j > result.square && inSquare[i])
+        {
+            result.square = j;
+            result.squareEnd = i;
+        }
+        if (j > result.any)
+        {
+            result.any = j;
+            result.anyEnd = i;
+        }
+    }
+    return result;
+}
+
+struct Entry
+{
+    std::size_t length = 0;
+    std::size_t begin = 0;    // Position in reversed boundary
+    std::size_t rotation = 0; // Word is rotated left by it
+};
+
+// Find longest entry of word rotations into reversed boundary
+// Entries ending at edges in squares are preferred on each rotation, then
+// earlier rotations and earlier positions, whatever number of threads is
+Entry findLongestEntry(const std::vector<GroupElement> &word,
+                       const std::vector<Transition> &reversedCircleWord,
+                       std::size_t threads)
+{
+    std::unordered_map<std::string, std::uint32_t> ids;
+    std::vector<std::uint32_t> codes;
+    for (const GroupElement &letter : word)
+    {
+        auto id = ids.emplace(letter.name, static_cast<std::uint32_t>(ids.size())).first->second;
+        codes.push_back(id * 2 + letter.reversed);
+    }
+    std::vector<std::uint32_t> text;
+    std::vector<char> inSquare;
+    text.reserve(reversedCircleWord.size());
+    inSquare.reserve(reversedCircleWord.size());
+    for (const Transition &tr : reversedCircleWord)
+    {
+        auto it = ids.find(tr.label.name);
+        text.push_back(it == ids.end() ? noLetter : it->second * 2 + tr.label.reversed);
+        inSquare.push_back(tr.isInSquare);
+    }
+
+    std::size_t rotations = word.size(), n = text.size();
+    std::size_t chunks = 1;
+    if (threads > 1 && rotations * n >= parallelMatchingWork && rotations < threads * 4)
+    {
+        // Rotations are too few to load all threads, boundary is split too
+        chunks = std::min((threads * 4 + rotations - 1) / rotations, std::max<std::size_t>(1, n / rotations));
+    }
+    else if (rotations * n < parallelMatchingWork)
+    {
+        threads = 1;
+    }
+    std::vector<EntryCandidates> candidates(rotations * chunks);
+    utility::parallelFor(candidates.size(), threads, [&](std::size_t begin, std::size_t end, std::size_t) {
+        std::vector<std::uint32_t> pattern(rotations);
+        std::vector<std::size_t> prefix(rotations);
+        for (std::size_t item = begin; item < end; ++item)
+        {
+            std::size_t rotation = item / chunks, chunk = item % chunks;
+            if (item == begin || chunk == 0)
+            {
+                std::rotate_copy(codes.begin(), codes.begin() + rotation, codes.end(), pattern.begin());
+                for (std::size_t i = 1; i < rotations; ++i)
+                {
+                    std::size_t j = prefix[i - 1];
+                    for (; j > 0 && pattern[i] != pattern[j]; j = prefix[j - 1])
+                        ;
+                    prefix[i] = j + (pattern[i] == pattern[j]);
+                }
+            }
+            candidates[item] = scanEntries(pattern, prefix, text, inSquare, n * chunk / chunks, n * (chunk + 1) / chunks);
+        }
+    });
+
+    // Same order of improvements as in serial scan: rotations one by one,
+    // on each square entries first
+    Entry best;
+    for (std::size_t rotation = 0; rotation < rotations; ++rotation)
+    {
+        EntryCandidates merged;
+        for (std::size_t chunk = 0; chunk < chunks; ++chunk)
+        {
+            merged.add(candidates[rotation * chunks + chunk]);
+        }
+        if (merged.square > best.length)
+        {
+            best = {merged.square, merged.squareEnd + 1 - merged.square, rotation};
+        }
+        if (merged.any > best.length)
+        {
+            best = {merged.any, merged.anyEnd + 1 - merged.any, rotation};
+        }
+    }
+    return best;
+}
+} // namespace
+
 bool GroupElement::operator==(const GroupElement &other) const
 {
     return name == other.name && reversed == other.reversed;
@@ -54,28 +222,153 @@ std::vector<Transition> Diagramm::getCircuit()
 }
 
 nodeId_t Diagramm::getTerminal() const noexcept { return terminal_; }
-void Diagramm::setTerminal(nodeId_t n) noexcept { terminal_ = n; }
+void Diagramm::setTerminal(nodeId_t n)
+{
+    terminal_ = n;
+    if (EventLog *log = graph_->eventLog())
+    {
+        log->setTerminal(n);
+    }
+}
+
+std::size_t Diagramm::cellsCount() const noexcept { return cells_.size(); }
+const CellLog &Diagramm::cells() const noexcept { return cells_; }
+
+void Diagramm::setCells(CellLog &&cells)
+{
+    cells_ = std::move(cells);
+    logCells(0);
+}
+
+const std::vector<GroupElement> &Diagramm::exposedSegment() const noexcept { return exposed_; }
+void Diagramm::setMatchingThreads(std::size_t threads) noexcept { matchingThreads_ = std::max<std::size_t>(1, threads); }
+std::chrono::nanoseconds Diagramm::matchingTime() const noexcept { return matchingTime_; }
+void Diagramm::addMatchingTime(std::chrono::nanoseconds time) noexcept { matchingTime_ += time; }
+
+void Diagramm::compact(const std::vector<nodeId_t> &order)
+{
+    std::vector<nodeId_t> newIds = graph_->compact(order);
+    auto remap = [&](nodeId_t v) {
+        return v >= 0 && static_cast<std::size_t>(v) < newIds.size() ? newIds[v] : Node::makeNonexistantNode();
+    };
+    terminal_ = remap(terminal_);
+    CellLog cells;
+    for (std::size_t cell = 0; cell < cells_.size(); ++cell)
+    {
+        for (std::size_t i = cells_.offsets[cell]; i < cells_.offsets[cell + 1]; ++i)
+        {
+            nodeId_t v = remap(cells_.nodes[i]);
+            if (!Node::isNonexistantNode(v))
+            {
+                cells.nodes.push_back(v);
+            }
+        }
+        cells.offsets.push_back(cells.nodes.size());
+    }
+    cells_ = std::move(cells);
+}
+
+void Diagramm::beginTransaction()
+{
+    graph_->beginTransaction();
+    savepoints_.push_back(Savepoint{terminal_, cells_.size(), cells_.nodes.size(), exposed_});
+}
+
+void Diagramm::commitTransaction()
+{
+    if (savepoints_.empty())
+    {
+        throw std::logic_error("no transaction to commit");
+    }
+    graph_->commitTransaction();
+    savepoints_.pop_back();
+}
+
+void Diagramm::rollbackTransaction()
+{
+    if (savepoints_.empty())
+    {
+        throw std::logic_error("no transaction to roll back");
+    }
+    graph_->rollbackTransaction();
+    Savepoint &savepoint = savepoints_.back();
+    cells_.offsets.resize(savepoint.cells + 1);
+    cells_.nodes.resize(savepoint.cellNodes);
+    terminal_ = savepoint.terminal;
+    exposed_ = std::move(savepoint.exposed);
+    savepoints_.pop_back();
+}
+
+void Diagramm::writeBinary(std::ostream &os) const
+{
+    os.write(diagramMagic, sizeof(diagramMagic) - 1);
+    utility::writeRaw(os, static_cast<std::int64_t>(terminal_));
+    utility::writeRaw(os, static_cast<std::uint64_t>(cells_.size()));
+    for (std::size_t cell = 0; cell < cells_.size(); ++cell)
+    {
+        utility::writeRaw(os, static_cast<std::uint32_t>(cells_.offsets[cell + 1] - cells_.offsets[cell]));
+        for (std::size_t i = cells_.offsets[cell]; i < cells_.offsets[cell + 1]; ++i)
+        {
+            utility::writeRaw(os, static_cast<std::int64_t>(cells_.nodes[i]));
+        }
+    }
+    graph_->writeBinary(os);
+}
+
+void Diagramm::readBinary(std::istream &is)
+{
+    char magic[sizeof(diagramMagic) - 1];
+    is.read(magic, sizeof(magic));
+    if (!is || std::memcmp(magic, diagramMagic, sizeof(magic)) != 0)
+    {
+        throw std::invalid_argument("binary diagram has invalid header");
+    }
+    auto terminal = utility::readRaw<std::int64_t>(is);
+    auto cellsCount = utility::readRaw<std::uint64_t>(is);
+    CellLog cells;
+    for (std::uint64_t cell = 0; cell < cellsCount; ++cell)
+    {
+        auto length = utility::readRaw<std::uint32_t>(is);
+        for (std::uint32_t i = 0; i < length; ++i)
+        {
+            cells.nodes.push_back(static_cast<nodeId_t>(utility::readRaw<std::int64_t>(is)));
+        }
+        cells.offsets.push_back(cells.nodes.size());
+    }
+    graph_->readBinary(is);
+    auto isNode = [&](std::int64_t v) { return v >= 0 && v < static_cast<std::int64_t>(graph_->nodes().size()); };
+    if ((terminal != -1 && !isNode(terminal)) ||
+        !std::all_of(cells.nodes.begin(), cells.nodes.end(), isNode))
+    {
+        throw std::invalid_argument("binary diagram is corrupted");
+    }
+    terminal_ = static_cast<nodeId_t>(terminal);
+    cells_ = std::move(cells);
+}
 
 bool Diagramm::bindWord(std::vector<GroupElement> word, bool force, bool hub)
 {
     bool isSquare = word.size() == 4;
-    double transitionPriority = 1.0 / static_cast<double>(word.size());
+    auto matchingStart = std::chrono::steady_clock::now();
     std::vector<Transition> circleWord = getCircuit();
+    std::vector<nodeId_t> cell;
     if (circleWord.empty())
     {
-        terminal_ = graph_->addNode();
+        setTerminal(graph_->addNode());
         nodeId_t curNode = terminal_;
+        cell.push_back(curNode);
         for (std::size_t i = 0; i < word.size() - 1; ++i)
         {
             nodeId_t prevNode = curNode;
             curNode = graph_->node(prevNode).addTransitionToNewNode(word[i], isSquare, hub);
             graph_->node(curNode).addTransition(prevNode, word[i].inversed(), isSquare, hub);
-            graph_->increaseNondirEdgePriority(prevNode, curNode, transitionPriority);
+            cell.push_back(curNode);
         }
         graph_->node(curNode).addTransition(terminal_, word.back(), isSquare, hub);
-        graph_->node(terminal_).addTransition(curNode, word.back().inversed(), isSquare, hub);
-        graph_->node(terminal_).swapLastAdditions();
-        graph_->increaseNondirEdgePriority(curNode, terminal_, transitionPriority);
+        graph_->node(terminal_).addFrontTransition(curNode, word.back().inversed(), isSquare, hub);
+        cells_.add(cell.begin(), cell.end());
+        logCells(cells_.size() - 1);
+        exposed_ = word;
         return true;
     }
 
@@ -87,58 +380,11 @@ bool Diagramm::bindWord(std::vector<GroupElement> word, bool force, bool hub)
 
     std::reverse(reversedCircleWord.begin(), reversedCircleWord.end());
 
-    std::size_t longestEntry = 0;
-    std::size_t entryBegin = 0;
-    std::size_t bestRotation = 0;
-
-    for (std::size_t rotation = 0; rotation < word.size(); ++rotation)
-    {
-        { // knuth morris pratt
-            std::vector<std::string> text;
-            auto addToken = [&](const GroupElement &g) {
-                text.emplace_back(g.reversed ? (g.name + "!") : g.name);
-            };
-            for (auto &letter : word)
-            {
-                addToken(letter);
-            }
-            text.emplace_back("\0");
-            for (Transition &letter : reversedCircleWord)
-            {
-                addToken(letter.label);
-            }
-            std::size_t n = text.size();
-            std::vector<int> pi(n);
-            for (std::size_t i = 1; i < n; ++i)
-            {
-                int j = pi[i - 1];
-                for (; j > 0 && text[i] != text[j]; j = pi[j - 1])
-                    ;
-                if (text[i] == text[j])
-                    ++j;
-                pi[i] = j;
-            }
-            for (std::size_t i = word.size() + 1; i < text.size(); ++i)
-            {
-                if (pi[i] > static_cast<int>(longestEntry) && reversedCircleWord[i - word.size() - 1].isInSquare)
-                {
-                    longestEntry = pi[i];
-                    entryBegin = i - longestEntry - word.size();
-                    bestRotation = rotation;
-                }
-            }
-            for (std::size_t i = word.size() + 1; i < text.size(); ++i)
-            {
-                if (pi[i] > static_cast<int>(longestEntry))
-                {
-                    longestEntry = pi[i];
-                    entryBegin = i - longestEntry - word.size();
-                    bestRotation = rotation;
-                }
-            }
-        }
-        std::rotate(word.begin(), word.begin() + 1, word.end());
-    }
+    Entry entry = findLongestEntry(word, reversedCircleWord, matchingThreads_);
+    matchingTime_ += std::chrono::steady_clock::now() - matchingStart;
+    std::size_t longestEntry = entry.length;
+    std::size_t entryBegin = entry.begin;
+    std::size_t bestRotation = entry.rotation;
 
     std::rotate(word.begin(), word.begin() + bestRotation, word.end());
 
@@ -152,6 +398,7 @@ bool Diagramm::bindWord(std::vector<GroupElement> word, bool force, bool hub)
 
     if (longestEntry == word.size())
     {
+        exposed_.clear();
         return true;
     }
 
@@ -167,23 +414,30 @@ bool Diagramm::bindWord(std::vector<GroupElement> word, bool force, bool hub)
     }
 
     auto curNode = branchFrom;
+    cell.push_back(curNode);
 
     for (std::size_t i = longestEntry; i < word.size() - 1; ++i)
     {
         auto prevNode = curNode;
         curNode = graph_->node(prevNode).addTransitionToNewNode(word[i], isSquare, hub);
         graph_->node(curNode).addTransition(prevNode, word[i].inversed(), isSquare, hub);
-        graph_->increaseNondirEdgePriority(curNode, prevNode, transitionPriority);
+        cell.push_back(curNode);
     }
     graph_->node(curNode).addTransition(branchTo, word.back(), isSquare, hub);
-    graph_->node(branchTo).addTransition(curNode, word.back().inversed(), isSquare, hub);
-    graph_->node(branchTo).swapLastAdditions();
-    graph_->increaseNondirEdgePriority(curNode, branchTo, transitionPriority);
+    // New edge lies in outer face of branchTo, between its boundary transitions
+    graph_->node(branchTo).addFrontTransition(curNode, word.back().inversed(), isSquare, hub);
 
-    for (std::size_t i = normalWordEntryBegin - 1; i < normalWordEntryBegin + longestEntry - 1; ++i)
+    // Cell closes along matched boundary from branchTo back to branchFrom
+    for (std::size_t i = normalWordEntryBegin + longestEntry - 1; i >= normalWordEntryBegin; --i)
     {
-        graph_->increaseNondirEdgePriority(circleWord[i].to, circleWord[i + 1].to, transitionPriority);
+        cell.push_back(circleWord[i].to);
     }
+    cells_.add(cell.begin(), cell.end());
+    logCells(cells_.size() - 1);
+
+    exposed_.assign(1, circleWord[normalWordEntryBegin - 1].label);
+    exposed_.insert(exposed_.end(), word.begin() + longestEntry, word.end());
+    exposed_.push_back(circleWord[normalWordEntryBegin + longestEntry].label);
 
     return true;
 }
@@ -276,6 +530,7 @@ bool Diagramm::merge(Diagramm &&other, std::size_t hint)
         return result;
     };
 
+    std::unordered_map<nodeId_t, nodeId_t> merged = {{otherRootNode, myRootNode}};
     nodeId_t prevMyPath = myRootNode;
     auto ng = pathNeighbours(0);
     graph_->mergeNodes(myRootNode, otherRootNode, ng);
@@ -286,11 +541,37 @@ bool Diagramm::merge(Diagramm &&other, std::size_t hint)
         prevMyPath = myCur;
         ng = pathNeighbours(i + 1);
         graph_->mergeNodes(myCur, otherCur, ng);
+        merged[otherCur] = myCur;
     }
     graph_->node(prevMyPath).swapLastAdditions();
 
-    terminal_ = myRootNode;
+    setTerminal(myRootNode);
+    for (std::size_t cell = 0; cell < other.cells_.size(); ++cell)
+    {
+        std::vector<nodeId_t> walk(other.cells_.nodes.begin() + other.cells_.offsets[cell],
+                                   other.cells_.nodes.begin() + other.cells_.offsets[cell + 1]);
+        for (nodeId_t &v : walk)
+        {
+            auto it = merged.find(v);
+            v = it == merged.end() ? v : it->second;
+        }
+        cells_.add(walk.begin(), walk.end());
+    }
+    // Cells of other diagram are logged already, replay follows merged nodes
+    logCells(cells_.size());
 
     return true;
 }
+
+void Diagramm::logCells(std::size_t first)
+{
+    if (EventLog *log = graph_->eventLog())
+    {
+        for (std::size_t cell = first; cell < cells_.size(); ++cell)
+        {
+            log->addCell(cells_, cell);
+        }
+        log->setCellsCount(cells_.size());
+    }
+}
 } // namespace van_kampen
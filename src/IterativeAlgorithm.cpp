@@ -1,4 +1,6 @@
 #include "IterativeAlgorithm.hpp"
+#include "RelationScheduler.hpp"
+#include "Utility.hpp"
 #include "VanKampenUtils.hpp"
 
 namespace van_kampen
@@ -20,12 +22,19 @@ void IterativeAlgorithm::generate(const std::vector<std::vector<GroupElement>> &
     ProcessLogger logger(totalIterations, std::clog, "Relations used", quiet);
     std::size_t increase = 0;
     isAdded.front() = true;
+    diagramm_.setMatchingThreads(threads ? threads : utility::defaultThreadsCount());
     diagramm_.bindWord(words.front(), false, true);
     logger.iterate();
+    cellsBound();
+    if (scheduled)
+    {
+        generateScheduled(words, logger, totalIterations);
+        return;
+    }
     auto iterateOverWordsOnce = [&]() {
         for (std::size_t i = 0; i < words.size(); ++i)
         {
-            if (logger.getIteration() >= totalIterations)
+            if (logger.getIteration() >= totalIterations || isStopped())
             {
                 break;
             }
@@ -35,6 +44,7 @@ void IterativeAlgorithm::generate(const std::vector<std::vector<GroupElement>> &
             {
                 isAdded[i] = true;
                 increase += 1;
+                cellsBound();
                 if (logger.iterate() >= totalIterations)
                 {
                     break;
@@ -61,6 +71,25 @@ void IterativeAlgorithm::generate(const std::vector<std::vector<GroupElement>> &
     }
 }
 
+void IterativeAlgorithm::generateScheduled(const std::vector<std::vector<GroupElement>> &words,
+                                           ProcessLogger &logger,
+                                           std::size_t totalIterations)
+{
+    RelationScheduler scheduler(words);
+    scheduler.bound(0);
+    bindScheduled(
+        diagramm_, words, scheduler, totalIterations - logger.getIteration(),
+        [&]() {
+            logger.iterate();
+            cellsBound();
+        },
+        [this]() { return isStopped(); });
+    if (logger.getIteration() < totalIterations && !quiet)
+    {
+        std::clog << "can not bind " << totalIterations - logger.getIteration() << " relations, finishing";
+    }
+}
+
 Diagramm &IterativeAlgorithm::diagramm()
 {
     return diagramm_;
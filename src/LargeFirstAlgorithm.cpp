@@ -1,4 +1,5 @@
 #include "LargeFirstAlgorithm.hpp"
+#include "Utility.hpp"
 #include "VanKampenUtils.hpp"
 
 namespace van_kampen
@@ -21,9 +22,11 @@ void LargeFirstAlgorithm::generate(const std::vector<std::vector<GroupElement>>
     auto added = [&](iterator it) {
         return isAdded[it - begin(words)];
     };
+    diagramm_.setMatchingThreads(threads ? threads : utility::defaultThreadsCount());
     diagramm_.bindWord(words.back(), false, true);
     isAdded.back() = true;
     logger.iterate();
+    cellsBound();
     bool oneAdded = false;
     bool force = false;
     auto add = [&](iterator it) {
@@ -35,6 +38,7 @@ void LargeFirstAlgorithm::generate(const std::vector<std::vector<GroupElement>>
         {
             isAdded[it - begin(words)] = true;
             oneAdded = true;
+            cellsBound();
             return true;
         }
         return false;
@@ -58,7 +62,10 @@ void LargeFirstAlgorithm::generate(const std::vector<std::vector<GroupElement>>
         bool success = true;
         while (!add(bigIt))
         {
-            if (rest-- == 0 && !infinite)
+            if (isStopped())
+                return;
+            // Small words end where big ones begin
+            if ((rest-- == 0 && !infinite) || smallIt >= bigIt)
             {
                 success = false;
                 break;
@@ -73,6 +80,9 @@ void LargeFirstAlgorithm::generate(const std::vector<std::vector<GroupElement>>
         if (success && logger.iterate() >= totalIterations)
             return;
 
+        if (isStopped())
+            return;
+
         bigIt = prevNotAdded(bigIt);
         if (smallIt >= bigIt)
         {
@@ -81,7 +91,7 @@ void LargeFirstAlgorithm::generate(const std::vector<std::vector<GroupElement>>
 
             if (!oneAdded)
             {
-                if (force && !quiet)
+                if (force)
                 {
                     if (!quiet)
                         std::clog << "can not bind " << totalIterations - logger.getIteration() << " relations, finishing";
@@ -0,0 +1,277 @@
+#include <cmath>
+#include <limits>
+#include <queue>
+
+#include "CsrGraph.hpp"
+#include "Layout.hpp"
+#include "Utility.hpp"
+
+namespace van_kampen
+{
+namespace
+{
+// Deterministic unit direction for node, used to separate coincident nodes
+Point jitterDirection(std::size_t id)
+{
+    double angle = static_cast<double>(id) * 2.399963229728653; // golden angle
+    return {std::cos(angle), std::sin(angle)};
+}
+} // namespace
+
+void computeLayout(Graph &graph, const std::vector<Transition> &circuit, const LayoutParameters &parameters)
+{
+    std::size_t n = graph.nodes().size();
+    if (n == 0)
+    {
+        return;
+    }
+    CsrGraph adjacency(graph);
+    double k = parameters.edgeLength;
+    double radius = k * std::max(static_cast<double>(circuit.size()) / (2.0 * M_PI),
+                                 std::sqrt(static_cast<double>(n) / M_PI));
+
+    std::vector<Point> positions(n), next(n);
+    std::vector<char> pinned(n, false);
+
+    // Pin boundary circuit on circle, it starts and ends in terminal
+    std::queue<nodeId_t> bfs;
+    std::vector<std::size_t> depth(n, 0);
+    std::vector<char> reached(n, false);
+    if (circuit.size() >= 2)
+    {
+        std::vector<Point> polygon = polygonCoordinates(Circle{Point{}, radius}, circuit.size(), M_PI / 2.0);
+        for (std::size_t i = 0; i < circuit.size(); ++i)
+        {
+            nodeId_t v = circuit[(i + circuit.size() - 1) % circuit.size()].to;
+            if (!pinned[v])
+            {
+                pinned[v] = reached[v] = true;
+                positions[v] = polygon[i];
+                bfs.push(v);
+            }
+        }
+    }
+
+    // Seed interior nodes between their closest boundary node and center
+    std::size_t maxDepth = 0;
+    while (!bfs.empty())
+    {
+        nodeId_t v = bfs.front();
+        bfs.pop();
+        for (std::size_t e = adjacency.offsets[v]; e < adjacency.offsets[v + 1]; ++e)
+        {
+            nodeId_t u = adjacency.adjacent[e];
+            if (!reached[u])
+            {
+                reached[u] = true;
+                depth[u] = depth[v] + 1;
+                maxDepth = std::max(maxDepth, depth[u]);
+                positions[u] = positions[v];
+                bfs.push(u);
+            }
+        }
+    }
+    for (std::size_t v = 0; v < n; ++v)
+    {
+        if (!reached[v])
+        {
+            positions[v] = jitterDirection(v) * (radius * 0.1);
+        }
+        else if (!pinned[v])
+        {
+            positions[v] = positions[v] * (1.0 - static_cast<double>(depth[v]) / (maxDepth + 1));
+        }
+    }
+
+    // Barycentric (Tutte) embedding by Jacobi iterations
+    for (std::size_t it = 0; it < parameters.embeddingIterations; ++it)
+    {
+        utility::parallelFor(n, parameters.threads, [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t v = begin; v < end; ++v)
+            {
+                std::size_t degree = adjacency.degree(v);
+                if (pinned[v] || degree == 0)
+                {
+                    next[v] = positions[v];
+                    continue;
+                }
+                Point sum;
+                for (std::size_t e = adjacency.offsets[v]; e < adjacency.offsets[v + 1]; ++e)
+                {
+                    sum = sum + positions[adjacency.adjacent[e]];
+                }
+                next[v] = sum / static_cast<double>(degree);
+            }
+        });
+        std::swap(positions, next);
+    }
+
+    // Fruchterman-Reingold refinement, repulsion only from nodes in neighbouring grid cells
+    // Every node moves less than third of distance to any edge near it, and so does
+    // every edge end, so embedding stays planar
+    double cellSize = std::max(2.0 * k, 2.0 * radius / std::sqrt(4.0 * n));
+    std::size_t side = static_cast<std::size_t>(std::ceil(2.0 * radius / cellSize)) + 1;
+    auto cellCoord = [&](double c) {
+        double cell = std::floor((c + radius) / cellSize);
+        return static_cast<std::size_t>(std::clamp(cell, 0.0, static_cast<double>(side - 1)));
+    };
+    std::vector<std::size_t> cellStart(side * side + 1), cellNodes(n), nodeCell(n);
+    auto forEachNear = [&](const Point &p, auto &&f) {
+        std::size_t cx = cellCoord(p.x), cy = cellCoord(p.y);
+        for (std::size_t y = cy ? cy - 1 : 0; y <= std::min(cy + 1, side - 1); ++y)
+        {
+            for (std::size_t x = cx ? cx - 1 : 0; x <= std::min(cx + 1, side - 1); ++x)
+            {
+                for (std::size_t i = cellStart[y * side + x]; i < cellStart[y * side + x + 1]; ++i)
+                {
+                    f(cellNodes[i]);
+                }
+            }
+        }
+    };
+    std::vector<Point> displacement(n);
+    std::vector<double> bound(n);
+    for (std::size_t it = 0; it < parameters.forceIterations; ++it)
+    {
+        double temperature = k * 0.5 * (1.0 - static_cast<double>(it) / parameters.forceIterations);
+
+        std::fill(cellStart.begin(), cellStart.end(), 0);
+        for (std::size_t v = 0; v < n; ++v)
+        {
+            nodeCell[v] = cellCoord(positions[v].y) * side + cellCoord(positions[v].x);
+            ++cellStart[nodeCell[v] + 1];
+        }
+        for (std::size_t c = 0; c < side * side; ++c)
+        {
+            cellStart[c + 1] += cellStart[c];
+        }
+        {
+            std::vector<std::size_t> filled(cellStart.begin(), cellStart.end() - 1);
+            for (std::size_t v = 0; v < n; ++v)
+            {
+                cellNodes[filled[nodeCell[v]]++] = v;
+            }
+        }
+
+        utility::parallelFor(n, parameters.threads, [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t v = begin; v < end; ++v)
+            {
+                displacement[v] = Point{};
+                bound[v] = temperature;
+                if (pinned[v] || graph.isRemoved(v))
+                {
+                    continue;
+                }
+                forEachNear(positions[v], [&](std::size_t u) {
+                    double d = distance(positions[v], positions[u]);
+                    if (u == v || d >= cellSize)
+                    {
+                        return;
+                    }
+                    if (d < 1e-9)
+                    {
+                        displacement[v] = displacement[v] + jitterDirection(v) * k;
+                        return;
+                    }
+                    displacement[v] = displacement[v] + (positions[v] - positions[u]) * (k * k / (d * d));
+                    for (std::size_t e = adjacency.offsets[u]; e < adjacency.offsets[u + 1]; ++e)
+                    {
+                        if (adjacency.adjacent[e] != static_cast<nodeId_t>(v))
+                        {
+                            bound[v] = std::min(bound[v], distance(Segment{positions[u], positions[adjacency.adjacent[e]]}, positions[v]) / 3.0);
+                        }
+                    }
+                });
+                for (std::size_t e = adjacency.offsets[v]; e < adjacency.offsets[v + 1]; ++e)
+                {
+                    nodeId_t to = adjacency.adjacent[e];
+                    Segment edge{positions[v], positions[to]};
+                    displacement[v] = displacement[v] + (edge.second - edge.first) * (distance(edge.first, edge.second) / k);
+                    auto boundByNode = [&](std::size_t u) {
+                        if (u != v && u != static_cast<std::size_t>(to))
+                        {
+                            bound[v] = std::min(bound[v], distance(edge, positions[u]) / 3.0);
+                        }
+                    };
+                    forEachNear(edge.first, boundByNode);
+                    if (distance(edge.first, edge.second) >= cellSize)
+                    {
+                        // Long edge, check nodes along it
+                        std::size_t samples = static_cast<std::size_t>(distance(edge.first, edge.second) / cellSize) + 1;
+                        for (std::size_t i = 1; i <= samples; ++i)
+                        {
+                            forEachNear(edge.first + (edge.second - edge.first) * (static_cast<double>(i) / samples), boundByNode);
+                        }
+                    }
+                    else
+                    {
+                        forEachNear(edge.second, boundByNode);
+                    }
+                }
+            }
+        });
+
+        // Long edges are not visible from grid cells of their neighbourhood
+        for (std::size_t v = 0; v < n; ++v)
+        {
+            for (std::size_t e = adjacency.offsets[v]; e < adjacency.offsets[v + 1]; ++e)
+            {
+                nodeId_t to = adjacency.adjacent[e];
+                Segment edge{positions[v], positions[to]};
+                double length = distance(edge.first, edge.second);
+                if (length < cellSize || static_cast<std::size_t>(to) < v)
+                {
+                    continue;
+                }
+                std::size_t samples = static_cast<std::size_t>(length / cellSize) + 1;
+                for (std::size_t i = 0; i <= samples; ++i)
+                {
+                    forEachNear(edge.first + (edge.second - edge.first) * (static_cast<double>(i) / samples), [&](std::size_t u) {
+                        if (u != v && u != static_cast<std::size_t>(to))
+                        {
+                            bound[u] = std::min(bound[u], distance(edge, positions[u]) / 3.0);
+                        }
+                    });
+                }
+            }
+        }
+
+        utility::parallelFor(n, parameters.threads, [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t v = begin; v < end; ++v)
+            {
+                next[v] = positions[v];
+                if (pinned[v] || graph.isRemoved(v))
+                {
+                    continue;
+                }
+                double length = distance(displacement[v], Point{});
+                Point moved = positions[v] + (length > bound[v] ? displacement[v] * (bound[v] / length) : displacement[v]);
+                if (distance(moved, Point{}) < radius)
+                {
+                    next[v] = moved;
+                }
+            }
+        });
+        std::swap(positions, next);
+    }
+
+    for (std::size_t v = 0; v < n; ++v)
+    {
+        graph.node(v).position = positions[v];
+    }
+    graph.setPositioned(true);
+}
+
+void printCoordinates(const Graph &graph, std::ostream &os)
+{
+    os.precision(std::numeric_limits<double>::max_digits10);
+    for (const Node &node : graph.nodes())
+    {
+        if (!graph.isRemoved(node.getId()))
+        {
+            os << node.getId() << ' ' << node.position.x << ' ' << node.position.y << '\n';
+        }
+    }
+    os.flush();
+}
+} // namespace van_kampen
@@ -0,0 +1,483 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+
+#include "LevelOfDetail.hpp"
+#include "Utility.hpp"
+
+namespace van_kampen
+{
+namespace
+{
+// Edges out of every cell have priority at least this, as in partitioner
+const double minEdgeWeight = 0.01;
+
+const std::size_t npos = static_cast<std::size_t>(-1);
+
+// Append neighbours accumulated in row to level, parallel edges are joined
+struct RowBuilder
+{
+    explicit RowBuilder(std::size_t size)
+        : slot(size, npos) {}
+
+    void add(std::size_t to, double weight, std::size_t count)
+    {
+        if (slot[to] == npos)
+        {
+            slot[to] = row.size();
+            row.push_back({to, weight, count});
+            return;
+        }
+        row[slot[to]].weight += weight;
+        row[slot[to]].count += count;
+    }
+
+    void flush(DetailLevel &level)
+    {
+        for (const Edge &edge : row)
+        {
+            level.adjacent.push_back(edge.to);
+            level.edgeWeight.push_back(edge.weight);
+            level.edgeCount.push_back(edge.count);
+            slot[edge.to] = npos;
+        }
+        level.offsets.push_back(level.adjacent.size());
+        row.clear();
+    }
+
+    struct Edge
+    {
+        std::size_t to;
+        double weight;
+        std::size_t count;
+    };
+    std::vector<std::size_t> slot;
+    std::vector<Edge> row;
+};
+
+// Level of size nodes built by chunks in parallel, addRow(v, builder) adds
+// neighbours of node v and returns its weight
+template <typename F>
+DetailLevel buildLevel(std::size_t size, std::size_t threads, F &&addRow)
+{
+    std::vector<DetailLevel> chunks(threads);
+    utility::parallelFor(size, threads, [&](std::size_t begin, std::size_t end, std::size_t chunk) {
+        RowBuilder builder(size);
+        for (std::size_t v = begin; v < end; ++v)
+        {
+            chunks[chunk].nodeWeight.push_back(addRow(v, builder));
+            builder.flush(chunks[chunk]);
+        }
+    });
+    DetailLevel level;
+    for (DetailLevel &chunk : chunks)
+    {
+        std::size_t base = level.adjacent.size();
+        for (std::size_t i = 1; i < chunk.offsets.size(); ++i)
+        {
+            level.offsets.push_back(base + chunk.offsets[i]);
+        }
+        level.adjacent.insert(level.adjacent.end(), chunk.adjacent.begin(), chunk.adjacent.end());
+        level.edgeWeight.insert(level.edgeWeight.end(), chunk.edgeWeight.begin(), chunk.edgeWeight.end());
+        level.edgeCount.insert(level.edgeCount.end(), chunk.edgeCount.begin(), chunk.edgeCount.end());
+        level.nodeWeight.insert(level.nodeWeight.end(), chunk.nodeWeight.begin(), chunk.nodeWeight.end());
+        chunk = DetailLevel{};
+    }
+    return level;
+}
+
+// Members of every group as offsets and list, by counting sort
+void groupMembers(const std::vector<std::size_t> &group, std::size_t count,
+                  std::vector<std::size_t> &offsets, std::vector<std::size_t> &members)
+{
+    offsets.assign(count + 1, 0);
+    for (std::size_t g : group)
+    {
+        ++offsets[g + 1];
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    members.resize(group.size());
+    std::vector<std::size_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (std::size_t v = 0; v < group.size(); ++v)
+    {
+        members[cursor[group[v]]++] = v;
+    }
+}
+
+// Level of clusters of fine level nodes, edges between clusters are joined
+DetailLevel contract(const DetailLevel &fine, const std::vector<std::size_t> &cluster, std::size_t count, std::size_t threads)
+{
+    std::vector<std::size_t> offsets, members;
+    groupMembers(cluster, count, offsets, members);
+    return buildLevel(count, threads, [&](std::size_t c, RowBuilder &builder) {
+        std::size_t weight = 0;
+        for (std::size_t m = offsets[c]; m < offsets[c + 1]; ++m)
+        {
+            std::size_t v = members[m];
+            weight += fine.nodeWeight[v];
+            for (std::size_t i = fine.offsets[v]; i < fine.offsets[v + 1]; ++i)
+            {
+                std::size_t to = cluster[fine.adjacent[i]];
+                if (to != c)
+                {
+                    builder.add(to, fine.edgeWeight[i], fine.edgeCount[i]);
+                }
+            }
+        }
+        return weight;
+    });
+}
+
+// Join nodes pairwise along edges of the largest weight per joined children
+// Every node proposes its best neighbour in parallel and mutual proposals are
+// joined, then the rest are matched greedily in order of ids
+// Returns group of every node, count is set to number of groups
+std::vector<std::size_t> match(const DetailLevel &level, const std::vector<std::size_t> &children,
+                               std::size_t maxChildren, std::size_t threads, std::size_t &count)
+{
+    std::size_t n = level.size();
+    std::vector<std::size_t> mate(n, npos), proposal(n);
+    auto best = [&](std::size_t v) {
+        std::size_t result = npos;
+        double bestRating = 0.0;
+        for (std::size_t i = level.offsets[v]; i < level.offsets[v + 1]; ++i)
+        {
+            std::size_t u = level.adjacent[i];
+            if (mate[u] != npos || children[u] + children[v] > maxChildren)
+            {
+                continue;
+            }
+            double rating = level.edgeWeight[i] / static_cast<double>(children[u] + children[v]);
+            if (result == npos || rating > bestRating || (rating == bestRating && u < result))
+            {
+                result = u;
+                bestRating = rating;
+            }
+        }
+        return result;
+    };
+    utility::parallelFor(n, threads, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t v = begin; v < end; ++v)
+        {
+            proposal[v] = best(v);
+        }
+    });
+    utility::parallelFor(n, threads, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t v = begin; v < end; ++v)
+        {
+            if (proposal[v] != npos && proposal[proposal[v]] == v)
+            {
+                mate[v] = proposal[v];
+            }
+        }
+    });
+    for (std::size_t v = 0; v < n; ++v)
+    {
+        if (mate[v] == npos)
+        {
+            std::size_t u = best(v);
+            if (u != npos)
+            {
+                mate[v] = u;
+                mate[u] = v;
+            }
+        }
+    }
+
+    std::vector<std::size_t> group(n, npos);
+    count = 0;
+    for (std::size_t v = 0; v < n; ++v)
+    {
+        if (group[v] == npos)
+        {
+            group[v] = count;
+            if (mate[v] != npos)
+            {
+                group[mate[v]] = count;
+            }
+            ++count;
+        }
+    }
+    return group;
+}
+} // namespace
+
+DetailHierarchy buildDetailLevels(const Graph &graph, const CellLog &cells, const DetailParameters &parameters)
+{
+    std::size_t threads = std::max<std::size_t>(1, parameters.threads);
+    std::size_t fanout = std::max<std::size_t>(2, parameters.fanout);
+    const auto &nodes = graph.nodes();
+    DetailHierarchy hierarchy;
+    std::vector<std::size_t> local(nodes.size(), npos);
+    for (std::size_t id = 0; id < nodes.size(); ++id)
+    {
+        if (!graph.isRemoved(id))
+        {
+            local[id] = hierarchy.diagramIds.size();
+            hierarchy.diagramIds.push_back(id);
+        }
+    }
+    auto localId = [&](nodeId_t v) {
+        return v >= 0 && static_cast<std::size_t>(v) < local.size() ? local[v] : npos;
+    };
+    hierarchy.levels.push_back(buildLevel(hierarchy.diagramIds.size(), threads, [&](std::size_t v, RowBuilder &builder) {
+        for (const Transition &tr : nodes[hierarchy.diagramIds[v]].transitions())
+        {
+            std::size_t to = localId(tr.to);
+            if (to != npos && to != v)
+            {
+                builder.add(to, tr.priority + minEdgeWeight, 1);
+            }
+        }
+        return std::size_t{1};
+    }));
+
+    // First level super-nodes start from cells, long cells like hub are cut
+    // into runs of fanout nodes along their walk, nodes out of cells are alone
+    std::size_t n = hierarchy.diagramIds.size();
+    std::vector<std::size_t> seed(n, npos);
+    std::size_t seedCount = 0;
+    for (std::size_t cell = 0; cell < cells.size(); ++cell)
+    {
+        std::size_t run = 0;
+        for (std::size_t i = cells.offsets[cell]; i < cells.offsets[cell + 1]; ++i)
+        {
+            std::size_t v = localId(cells.nodes[i]);
+            if (v == npos || seed[v] != npos)
+            {
+                continue;
+            }
+            if (run == fanout)
+            {
+                ++seedCount;
+                run = 0;
+            }
+            seed[v] = seedCount;
+            ++run;
+        }
+        seedCount += run > 0;
+    }
+    for (std::size_t &s : seed)
+    {
+        if (s == npos)
+        {
+            s = seedCount++;
+        }
+    }
+
+    while (hierarchy.levels.size() == 1 || hierarchy.levels.back().size() > parameters.overviewSize)
+    {
+        const DetailLevel &fine = hierarchy.levels.back();
+        std::vector<std::size_t> cluster(fine.size());
+        std::size_t count = fine.size();
+        if (hierarchy.levels.size() == 1)
+        {
+            cluster = seed;
+            count = seedCount;
+        }
+        else
+        {
+            std::iota(cluster.begin(), cluster.end(), 0);
+        }
+        DetailLevel coarse = contract(fine, cluster, count, threads);
+        std::vector<std::size_t> children(count, 0);
+        for (std::size_t c : cluster)
+        {
+            ++children[c];
+        }
+        std::size_t target = std::max(fine.size() / fanout, parameters.overviewSize);
+        while (coarse.size() > target)
+        {
+            std::size_t joinedCount = 0;
+            std::vector<std::size_t> joined = match(coarse, children, 2 * fanout, threads, joinedCount);
+            if (joinedCount * 20 > coarse.size() * 19)
+            {
+                break; // Matching does not shrink level anymore
+            }
+            std::vector<std::size_t> joinedChildren(joinedCount, 0);
+            for (std::size_t c = 0; c < coarse.size(); ++c)
+            {
+                joinedChildren[joined[c]] += children[c];
+            }
+            for (std::size_t &c : cluster)
+            {
+                c = joined[c];
+            }
+            coarse = contract(coarse, joined, joinedCount, threads);
+            children = std::move(joinedChildren);
+        }
+        if (coarse.size() == fine.size())
+        {
+            break;
+        }
+        hierarchy.levels.back().parent = std::move(cluster);
+        hierarchy.levels.push_back(std::move(coarse));
+    }
+    return hierarchy;
+}
+
+void writeDetailLevels(const Graph &graph,
+                       const DetailHierarchy &hierarchy,
+                       const std::string &directory,
+                       graphOutputFormat format,
+                       const std::string &extension,
+                       std::size_t threads)
+{
+    const auto &levels = hierarchy.levels;
+    std::size_t top = levels.size() - 1;
+
+    // Position of super-node is average of its diagram nodes, super-node is
+    // highlighted if it has terminal inside
+    std::vector<std::vector<Point>> positions(levels.size());
+    std::vector<std::vector<char>> highlighted(levels.size());
+    positions[0].resize(levels[0].size());
+    highlighted[0].resize(levels[0].size());
+    for (std::size_t v = 0; v < levels[0].size(); ++v)
+    {
+        positions[0][v] = graph.node(hierarchy.diagramIds[v]).position;
+        highlighted[0][v] = graph.node(hierarchy.diagramIds[v]).isHighlighted();
+    }
+    for (std::size_t l = 0; l < top; ++l)
+    {
+        positions[l + 1].assign(levels[l + 1].size(), Point{});
+        highlighted[l + 1].assign(levels[l + 1].size(), false);
+        for (std::size_t v = 0; v < levels[l].size(); ++v)
+        {
+            std::size_t p = levels[l].parent[v];
+            positions[l + 1][p] = positions[l + 1][p] + positions[l][v] * static_cast<double>(levels[l].nodeWeight[v]);
+            highlighted[l + 1][p] |= highlighted[l][v];
+        }
+        for (std::size_t p = 0; p < levels[l + 1].size(); ++p)
+        {
+            positions[l + 1][p] = positions[l + 1][p] / static_cast<double>(levels[l + 1].nodeWeight[p]);
+        }
+    }
+
+    // Members of super-nodes of every level, overview has all top level nodes
+    std::vector<std::vector<std::size_t>> offsets(levels.size()), members(levels.size());
+    for (std::size_t l = 0; l < top; ++l)
+    {
+        groupMembers(levels[l].parent, levels[l + 1].size(), offsets[l], members[l]);
+    }
+    offsets[top] = {0, levels[top].size()};
+    members[top].resize(levels[top].size());
+    std::iota(members[top].begin(), members[top].end(), 0);
+    std::vector<std::vector<nodeId_t>> rank(levels.size());
+    for (std::size_t l = 0; l <= top; ++l)
+    {
+        rank[l].resize(levels[l].size());
+        for (std::size_t g = 0; g + 1 < offsets[l].size(); ++g)
+        {
+            for (std::size_t m = offsets[l][g]; m < offsets[l][g + 1]; ++m)
+            {
+                rank[l][members[l][m]] = m - offsets[l][g];
+            }
+        }
+    }
+    std::vector<std::size_t> local(graph.nodes().size(), npos);
+    for (std::size_t v = 0; v < hierarchy.diagramIds.size(); ++v)
+    {
+        local[hierarchy.diagramIds[v]] = v;
+    }
+
+    // Graph of nodes of level l inside group g of them
+    auto groupGraph = [&](std::size_t l, std::size_t g, Graph &result) {
+        result.setPositioned(graph.isPositioned());
+        auto inside = [&](std::size_t v) { return l == top || levels[l].parent[v] == g; };
+        for (std::size_t m = offsets[l][g]; m < offsets[l][g + 1]; ++m)
+        {
+            std::size_t v = members[l][m];
+            Node &node = result.node(result.addNode());
+            node.position = positions[l][v];
+            node.highlightNode(highlighted[l][v]);
+            if (l > 0)
+            {
+                node.setDiagramComment(std::to_string(l) + "-" + std::to_string(v));
+                for (std::size_t i = levels[l].offsets[v]; i < levels[l].offsets[v + 1]; ++i)
+                {
+                    std::size_t u = levels[l].adjacent[i];
+                    if (inside(u))
+                    {
+                        GroupElement label{std::to_string(levels[l].edgeCount[i]), u < v};
+                        node.addTransition(Transition{rank[l][u], label, false, levels[l].edgeWeight[i], false});
+                    }
+                }
+                continue;
+            }
+            bool boundary = false;
+            for (const Transition &tr : graph.node(hierarchy.diagramIds[v]).transitions())
+            {
+                std::size_t u = tr.to >= 0 && static_cast<std::size_t>(tr.to) < local.size() ? local[tr.to] : npos;
+                if (u == npos)
+                {
+                    continue;
+                }
+                if (inside(u))
+                {
+                    node.addTransition(Transition{rank[l][u], tr.label, tr.isInSquare, tr.priority, tr.isInHub});
+                    continue;
+                }
+                boundary = true;
+            }
+            if (boundary)
+            {
+                node.setDiagramComment(std::to_string(hierarchy.diagramIds[v]));
+            }
+        }
+    };
+    auto write = [&](const std::string &name, std::size_t l, std::size_t g) {
+        std::ofstream file(std::filesystem::path(directory) / (name + "." + extension));
+        if (!file.good())
+        {
+            throw std::invalid_argument("cannot write to directory '" + directory + "'");
+        }
+        Graph part;
+        groupGraph(l, g, part);
+        part.printSelf(file, format);
+    };
+
+    // Detail files of all levels are written in parallel, overview is the last
+    std::vector<std::size_t> firstFile(levels.size() + 1, 0);
+    for (std::size_t l = 1; l <= top; ++l)
+    {
+        firstFile[l + 1] = firstFile[l] + levels[l].size();
+    }
+    utility::parallelFor(firstFile[top + 1] + 1, threads, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t f = begin; f < end; ++f)
+        {
+            if (f == firstFile[top + 1])
+            {
+                write("overview", top, 0);
+                continue;
+            }
+            std::size_t l = std::upper_bound(firstFile.begin(), firstFile.end(), f) - firstFile.begin() - 1;
+            std::size_t g = f - firstFile[l];
+            write(std::to_string(l) + "-" + std::to_string(g), l - 1, g);
+        }
+    });
+
+    std::ofstream index(std::filesystem::path(directory) / "levels.txt");
+    if (!index.good())
+    {
+        throw std::invalid_argument("cannot write to directory '" + directory + "'");
+    }
+    for (std::size_t l = 1; l <= top; ++l)
+    {
+        for (std::size_t v = 0; v < levels[l].size(); ++v)
+        {
+            index << l << ' ' << v << ' ';
+            if (l < top)
+            {
+                index << levels[l].parent[v];
+            }
+            else
+            {
+                index << '-';
+            }
+            index << ' ' << levels[l].nodeWeight[v] << '\n';
+        }
+    }
+    index.flush();
+}
+} // namespace van_kampen
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "LookaheadAlgorithm.hpp"
+#include "Utility.hpp"
+#include "VanKampenUtils.hpp"
+
+namespace van_kampen
+{
+LookaheadAlgorithm::LookaheadAlgorithm()
+    : diagramm_(graph_) {}
+
+void LookaheadAlgorithm::generate(const std::vector<std::vector<GroupElement>> &words_)
+{
+    auto words = words_;
+    std::reverse(words.begin(), words.end());
+    std::size_t totalIterations = words.size();
+    if (cellsLimit)
+    {
+        totalIterations = std::min(totalIterations, cellsLimit);
+    }
+    std::vector<bool> isAdded(words.size());
+    ProcessLogger logger(totalIterations, std::clog, "Relations used", quiet);
+    isAdded.front() = true;
+    minBoundary_ = 0;
+    for (std::size_t i = 1; i < words.size(); ++i)
+    {
+        minBoundary_ = std::max(minBoundary_, words[i].size());
+    }
+    diagramm_.setMatchingThreads(threads ? threads : utility::defaultThreadsCount());
+    diagramm_.bindWord(words.front(), false, true);
+    logger.iterate();
+    cellsBound();
+    for (bool forced : {false, true})
+    {
+        std::size_t cursor = 1;
+        std::size_t chosen = 0, boundary = 0;
+        while (logger.getIteration() < totalIterations && !isStopped() &&
+               search(words, isAdded, cursor, std::max<std::size_t>(1, depth), forced, chosen, boundary))
+        {
+            // Bind is repeated on the same diagram, so it gives the same result
+            if (!diagramm_.bindWord(words[chosen], forced, false))
+            {
+                throw std::logic_error("relation chosen by lookahead does not bind");
+            }
+            isAdded[chosen] = true;
+            cellsBound();
+            logger.iterate();
+            cursor = chosen + 1;
+        }
+    }
+    if (logger.getIteration() < totalIterations && !quiet)
+    {
+        std::clog << "can not bind " << totalIterations - logger.getIteration() << " relations, finishing";
+    }
+}
+
+bool LookaheadAlgorithm::search(const std::vector<std::vector<GroupElement>> &words,
+                                std::vector<bool> &isAdded,
+                                std::size_t from,
+                                std::size_t levels,
+                                bool forced,
+                                std::size_t &chosen,
+                                std::size_t &boundary)
+{
+    bool found = false;
+    std::size_t tried = 0;
+    for (std::size_t k = 0; k < words.size() && tried < std::max<std::size_t>(1, width) && !isStopped(); ++k)
+    {
+        std::size_t i = (from + k) % words.size();
+        if (isAdded[i])
+        {
+            continue;
+        }
+        diagramm_.beginTransaction();
+        if (diagramm_.bindWord(words[i], forced, false))
+        {
+            ++tried;
+            std::size_t length = 0, next = 0;
+            isAdded[i] = true;
+            if (levels < 2 || !search(words, isAdded, i + 1, levels - 1, forced, next, length))
+            {
+                length = diagramm_.getCircuit().size();
+            }
+            isAdded[i] = false;
+            // Boundary shorter than relations gets few of them to bind, so
+            // the shortest one is chosen above that length, the longest below
+            bool isOpen = length >= minBoundary_, wasOpen = boundary >= minBoundary_;
+            if (!found || (isOpen != wasOpen ? isOpen : (isOpen ? length < boundary : length > boundary)))
+            {
+                found = true;
+                boundary = length;
+                chosen = i;
+            }
+        }
+        diagramm_.rollbackTransaction();
+    }
+    return found;
+}
+
+Diagramm &LookaheadAlgorithm::diagramm()
+{
+    return diagramm_;
+}
+} // namespace van_kampen
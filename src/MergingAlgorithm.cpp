@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "MergingAlgorithm.hpp"
 
 namespace van_kampen
@@ -21,7 +23,7 @@ void MergingAlgorithm::generate(const std::vector<std::vector<van_kampen::GroupE
         diagrams.back().bindWord(word, false, false);
     }
     van_kampen::ProcessLogger log{diagrams.size(), std::cout, "Merging", quiet};
-    while (diagrams.size() > 1)
+    while (diagrams.size() > 1 && !isStopped())
     {
         std::vector<std::pair<van_kampen::Diagramm, std::vector<van_kampen::Transition>>> circuits;
         for (std::size_t i = 0; i < diagrams.size(); ++i)
@@ -63,6 +65,7 @@ void MergingAlgorithm::generate(const std::vector<std::vector<van_kampen::GroupE
             else
             {
                 log.iterate();
+                cellsBound();
                 atleastOne = true;
                 diagrams.push_back(std::move(cur));
             }
@@ -72,7 +75,10 @@ void MergingAlgorithm::generate(const std::vector<std::vector<van_kampen::GroupE
             throw std::logic_error("cannot build diagram");
         }
     }
-    result_ = diagrams[0];
+    // Generation may be stopped with several diagrams, the largest one is kept
+    result_ = *std::max_element(diagrams.begin(), diagrams.end(), [](const Diagramm &a, const Diagramm &b) {
+        return a.cellsCount() < b.cellsCount();
+    });
 }
 
 Diagramm &MergingAlgorithm::diagramm()
@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <string>
+
+#include "Portfolio.hpp"
+#include "Utility.hpp"
+
+namespace van_kampen
+{
+namespace
+{
+// Returns options read by algorithm of run, as in command line flags
+std::string runOptions(const GenerationParameters &parameters)
+{
+    switch (parameters.algorithm)
+    {
+    case algorithmType::ITERATIVE:
+        return parameters.scheduled ? "scheduled" : "-";
+    case algorithmType::LARGE_FIRST:
+        return "per-large=" + std::to_string(parameters.perLarge);
+    case algorithmType::SHARDED:
+        return "shards=" + std::to_string(parameters.shards);
+    case algorithmType::LOOKAHEAD:
+        return "lookahead=" + std::to_string(parameters.lookaheadWidth) + "x" +
+               std::to_string(parameters.lookaheadDepth);
+    default:
+        return "-";
+    }
+}
+} // namespace
+
+bool portfolioAlternatesAlgorithms(const GenerationParameters &base)
+{
+    // Scheduled retries exist in iterative algorithm only, other algorithms
+    // have no counterpart to alternate with
+    return !base.scheduled &&
+           (base.algorithm == algorithmType::ITERATIVE || base.algorithm == algorithmType::LARGE_FIRST);
+}
+
+GenerationParameters portfolioRunParameters(const GenerationParameters &base, std::size_t index)
+{
+    GenerationParameters parameters = base;
+    parameters.quiet = true;
+    parameters.threads = 1; // Runs are parallel already
+    if (index == 0)
+    {
+        return parameters;
+    }
+    parameters.shuffle = true;
+    parameters.seed = base.seed + index;
+    if (portfolioAlternatesAlgorithms(base) && index % 2 == 1)
+    {
+        parameters.algorithm = base.algorithm == algorithmType::ITERATIVE ? algorithmType::LARGE_FIRST
+                                                                            : algorithmType::ITERATIVE;
+    }
+    if (parameters.algorithm == algorithmType::LARGE_FIRST)
+    {
+        // Cycle through base, halved and doubled number of small words per large one
+        std::size_t variant = (index / 2) % 3;
+        if (variant == 1)
+        {
+            parameters.perLarge = std::max<std::size_t>(1, base.perLarge / 2);
+        }
+        else if (variant == 2)
+        {
+            parameters.perLarge = base.perLarge * 2;
+        }
+    }
+    return parameters;
+}
+
+PortfolioResult runPortfolio(const std::vector<std::vector<GroupElement>> &words,
+                             const GenerationParameters &base,
+                             std::size_t runs,
+                             std::size_t threads,
+                             bool stopOnComplete)
+{
+    runs = std::max<std::size_t>(1, runs);
+    std::size_t target = words.size();
+    if (base.cellsLimit)
+    {
+        target = std::min(target, base.cellsLimit);
+    }
+
+    PortfolioResult result;
+    result.runs.resize(runs);
+    std::vector<std::unique_ptr<DiagrammGeneratingAlgorithm>> algorithms(runs);
+    std::atomic_bool stop{false};
+    utility::parallelFor(runs, threads, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            PortfolioRun &run = result.runs[i];
+            run.parameters = portfolioRunParameters(base, i);
+            if (stop)
+            {
+                continue;
+            }
+            auto start = std::chrono::steady_clock::now();
+            auto runWords = words;
+            prepareWords(runWords, run.parameters);
+            algorithms[i] = makeAlgorithm(run.parameters);
+            algorithms[i]->stop = &stop;
+            algorithms[i]->generate(runWords);
+
+            run.started = true;
+            run.cells = algorithms[i]->diagramm().cellsCount();
+            run.boundary = algorithms[i]->diagramm().getCircuit().size();
+            run.nodes = algorithms[i]->graph().nodes().size();
+            run.complete = run.cells >= target;
+            run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (run.complete && stopOnComplete)
+            {
+                stop = true;
+            }
+            algorithms[i]->stop = nullptr;
+        }
+    });
+
+    for (std::size_t i = 0; i < runs; ++i)
+    {
+        const PortfolioRun &run = result.runs[i];
+        const PortfolioRun &best = result.runs[result.bestRun];
+        if (run.started && (!best.started || run.cells > best.cells ||
+                            (run.cells == best.cells && run.boundary < best.boundary)))
+        {
+            result.bestRun = i;
+        }
+    }
+    result.best = std::move(algorithms[result.bestRun]);
+    return result;
+}
+
+void printPortfolio(const PortfolioResult &result, std::ostream &os)
+{
+    os << "run algorithm   options       seed       cells  boundary nodes      seconds\n";
+    for (std::size_t i = 0; i < result.runs.size(); ++i)
+    {
+        const PortfolioRun &run = result.runs[i];
+        const GenerationParameters &parameters = run.parameters;
+        os << std::left << std::setw(4) << i
+           << std::setw(12) << algorithmName(parameters.algorithm)
+           << std::setw(14) << runOptions(parameters)
+           << std::setw(11) << (parameters.shuffle ? std::to_string(parameters.seed) : "-");
+        if (!run.started)
+        {
+            os << "skipped\n";
+            continue;
+        }
+        os << std::setw(7) << run.cells
+           << std::setw(9) << run.boundary
+           << std::setw(11) << run.nodes
+           << std::fixed << std::setprecision(2) << run.seconds
+           << (run.complete ? " complete" : "")
+           << (i == result.bestRun ? " best" : "") << '\n';
+    }
+    os << std::right;
+    os.flush();
+}
+} // namespace van_kampen
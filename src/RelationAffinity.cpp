@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <queue>
+#include <string>
+#include <unordered_map>
+
+#include "RelationAffinity.hpp"
+#include "Utility.hpp"
+
+namespace van_kampen
+{
+namespace
+{
+// Append letter code to k-mer hash
+std::uint64_t mix(std::uint64_t hash, std::uint64_t letter)
+{
+    hash = (hash ^ letter) * 0x9e3779b97f4a7c15ULL;
+    return hash ^ (hash >> 29);
+}
+} // namespace
+
+AffinityIndex::AffinityIndex(const std::vector<std::vector<GroupElement>> &words, std::size_t k, std::size_t threads)
+    : kmers_(words.size()), lengths_(words.size(), 0), scores_(words.size(), 0)
+{
+    k = std::max<std::size_t>(1, k);
+    std::unordered_map<std::string, kmer_t> letters;
+    for (const auto &word : words)
+    {
+        for (const GroupElement &letter : word)
+        {
+            letters.emplace(letter.name, letters.size());
+        }
+    }
+
+    utility::parallelFor(words.size(), threads, [&](std::size_t begin, std::size_t end, std::size_t) {
+        std::vector<kmer_t> codes;
+        std::vector<Kmer> found;
+        for (std::size_t r = begin; r < end; ++r)
+        {
+            const auto &word = words[r];
+            if (word.size() < k)
+            {
+                continue;
+            }
+            codes.resize(word.size());
+            for (std::size_t i = 0; i < word.size(); ++i)
+            {
+                codes[i] = letters.find(word[i].name)->second * 2 + word[i].reversed;
+            }
+            found.clear();
+            for (std::size_t i = 0; i < word.size(); ++i)
+            {
+                // Matching k-mer has inversed letters in reversed order
+                kmer_t code = 0, match = 0;
+                for (std::size_t j = 0; j < k; ++j)
+                {
+                    code = mix(code, codes[(i + j) % word.size()]);
+                    match = mix(match, codes[(i + k - 1 - j) % word.size()] ^ 1);
+                }
+                found.push_back({code, match, 1});
+            }
+            std::sort(found.begin(), found.end(), [](const Kmer &a, const Kmer &b) { return a.code < b.code; });
+            for (const Kmer &kmer : found)
+            {
+                if (kmers_[r].empty() || kmers_[r].back().code != kmer.code)
+                {
+                    kmers_[r].push_back({kmer.code, kmer.match, 0});
+                }
+                ++kmers_[r].back().count;
+            }
+            lengths_[r] = word.size();
+        }
+    });
+
+    std::unordered_map<kmer_t, std::size_t> totals;
+    for (const auto &kmers : kmers_)
+    {
+        for (const Kmer &kmer : kmers)
+        {
+            totals[kmer.code] += kmer.count;
+        }
+    }
+    utility::parallelFor(words.size(), threads, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t r = begin; r < end; ++r)
+        {
+            for (const Kmer &kmer : kmers_[r])
+            {
+                auto it = totals.find(kmer.match);
+                if (it != totals.end())
+                {
+                    scores_[r] += std::min(kmer.count, it->second - count(r, kmer.match));
+                }
+            }
+        }
+    });
+}
+
+std::size_t AffinityIndex::count(std::size_t relation, kmer_t code) const
+{
+    const auto &kmers = kmers_[relation];
+    auto it = std::lower_bound(kmers.begin(), kmers.end(), code, [](const Kmer &kmer, kmer_t value) { return kmer.code < value; });
+    return it != kmers.end() && it->code == code ? it->count : 0;
+}
+
+std::size_t AffinityIndex::pairAffinity(std::size_t a, std::size_t b) const
+{
+    std::size_t result = 0;
+    for (const Kmer &kmer : kmers_[b])
+    {
+        result += std::min(kmer.count, count(a, kmer.match));
+    }
+    return result;
+}
+
+const std::vector<std::size_t> &AffinityIndex::scores() const noexcept
+{
+    return scores_;
+}
+
+std::vector<std::size_t> AffinityIndex::chainOrder() const
+{
+    if (kmers_.empty())
+    {
+        return {};
+    }
+    const std::size_t npos = static_cast<std::size_t>(-1);
+    std::size_t hub = kmers_.size() - 1;
+
+    // Relations containing every k-mer with its count, larger counts first
+    std::unordered_map<kmer_t, std::size_t> ids;
+    for (const auto &kmers : kmers_)
+    {
+        for (const Kmer &kmer : kmers)
+        {
+            ids.emplace(kmer.code, ids.size());
+        }
+    }
+    std::vector<std::vector<std::pair<std::size_t, std::size_t>>> containing(ids.size());
+    for (std::size_t r = 0; r < hub; ++r)
+    {
+        for (const Kmer &kmer : kmers_[r])
+        {
+            containing[ids[kmer.code]].emplace_back(kmer.count, r);
+        }
+    }
+    for (auto &relations : containing)
+    {
+        std::stable_sort(relations.begin(), relations.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+    }
+    std::vector<std::size_t> matchingId(ids.size(), npos);
+    for (const auto &kmers : kmers_)
+    {
+        for (const Kmer &kmer : kmers)
+        {
+            auto it = ids.find(kmer.match);
+            if (it != ids.end())
+            {
+                matchingId[ids[kmer.code]] = it->second;
+            }
+        }
+    }
+
+    // Placed occurrences of every k-mer, relation gains one matched k-mer
+    // when placed count of k-mer matching its own one reaches its count
+    std::vector<std::size_t> placed(ids.size(), 0), matched(hub, 0);
+    std::vector<char> isPlaced(hub, false);
+    std::priority_queue<std::pair<double, std::size_t>> queue;
+    auto share = [&](std::size_t r) {
+        return lengths_[r] ? static_cast<double>(matched[r]) / static_cast<double>(lengths_[r]) : 0.0;
+    };
+    auto place = [&](std::size_t r) {
+        for (const Kmer &kmer : kmers_[r])
+        {
+            std::size_t id = ids[kmer.code];
+            if (matchingId[id] == npos)
+            {
+                continue;
+            }
+            const auto &relations = containing[matchingId[id]];
+            for (std::size_t i = 0; i < kmer.count; ++i)
+            {
+                std::size_t before = placed[id]++;
+                for (const auto &[need, other] : relations)
+                {
+                    if (need <= before)
+                    {
+                        break;
+                    }
+                    if (!isPlaced[other])
+                    {
+                        ++matched[other];
+                        queue.emplace(share(other), other);
+                    }
+                }
+            }
+        }
+    };
+
+    for (std::size_t r = 0; r < hub; ++r)
+    {
+        queue.emplace(0.0, r);
+    }
+    place(hub);
+    std::vector<std::size_t> order;
+    order.reserve(hub);
+    while (!queue.empty())
+    {
+        auto [value, r] = queue.top();
+        queue.pop();
+        if (isPlaced[r] || value != share(r))
+        {
+            continue; // Stale entry
+        }
+        isPlaced[r] = true;
+        order.push_back(r);
+        place(r);
+    }
+    return order;
+}
+
+void orderByAffinity(std::vector<std::vector<GroupElement>> &words, std::size_t k, std::size_t threads)
+{
+    if (words.size() < 2)
+    {
+        return;
+    }
+    std::vector<std::size_t> order = AffinityIndex(words, k, threads).chainOrder();
+    // Iterative algorithm tries relations from the end
+    std::vector<std::vector<GroupElement>> ordered;
+    ordered.reserve(words.size());
+    for (auto it = order.rbegin(); it != order.rend(); ++it)
+    {
+        ordered.push_back(std::move(words[*it]));
+    }
+    ordered.push_back(std::move(words.back()));
+    words = std::move(ordered);
+}
+} // namespace van_kampen
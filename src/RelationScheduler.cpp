@@ -0,0 +1,174 @@
+#include <algorithm>
+
+#include "RelationScheduler.hpp"
+
+namespace van_kampen
+{
+RelationScheduler::RelationScheduler(const std::vector<std::vector<GroupElement>> &words)
+    : words_(words), isBound_(words.size(), false)
+{
+    wakeAll();
+    for (std::size_t id = 0; id < words.size(); ++id)
+    {
+        const auto &word = words[id];
+        std::vector<key_t> letters, pairs;
+        for (std::size_t i = 0; i < word.size(); ++i)
+        {
+            letters.push_back(letterKey(word[i]));
+            pairs.push_back(pairKey(word[i], word[(i + 1) % word.size()]));
+        }
+        // Every relation is listed once per key
+        for (auto *keys : {&letters, &pairs})
+        {
+            std::sort(keys->begin(), keys->end());
+            keys->erase(std::unique(keys->begin(), keys->end()), keys->end());
+        }
+        if (word.size() == 4)
+        {
+            for (const key_t &key : letters)
+            {
+                bySquareLetter_[key].push_back(id); // Squares may bind by one letter
+            }
+        }
+        for (const key_t &key : pairs)
+        {
+            byPair_[key].push_back(id);
+        }
+    }
+}
+
+RelationScheduler::key_t RelationScheduler::letterKey(const GroupElement &letter)
+{
+    return letter.reversed ? letter.name + "!" : letter.name;
+}
+
+RelationScheduler::key_t RelationScheduler::pairKey(const GroupElement &first, const GroupElement &second)
+{
+    return letterKey(first) + ' ' + letterKey(second);
+}
+
+void RelationScheduler::expose(const std::vector<GroupElement> &segment)
+{
+    // Word binds along inversed boundary read backwards, so boundary pair (a, b)
+    // is matched by relation pair (b^-1, a^-1)
+    std::vector<key_t> inversed;
+    for (auto it = segment.rbegin(); it != segment.rend(); ++it)
+    {
+        inversed.push_back(letterKey(it->inversed()));
+    }
+    auto wake = [&](const std::unordered_map<key_t, std::vector<std::size_t>> &index, const key_t &key) {
+        auto it = index.find(key);
+        if (it == index.end())
+        {
+            return;
+        }
+        for (std::size_t id : it->second)
+        {
+            if (!isBound_[id])
+            {
+                awake_.insert(id);
+            }
+        }
+    };
+    for (std::size_t i = 0; i + 1 < inversed.size(); ++i)
+    {
+        wake(byPair_, inversed[i] + ' ' + inversed[i + 1]);
+    }
+    for (std::size_t i = 0; i < inversed.size(); ++i)
+    {
+        wake(bySquareLetter_, inversed[i]);
+    }
+}
+
+void RelationScheduler::bound(std::size_t id)
+{
+    isBound_[id] = true;
+    awake_.erase(id);
+}
+
+void RelationScheduler::failed(std::size_t id)
+{
+    awake_.erase(id);
+}
+
+void RelationScheduler::sleepAll()
+{
+    awake_.clear();
+}
+
+void RelationScheduler::wakeAll()
+{
+    for (std::size_t id = 0; id < words_.size(); ++id)
+    {
+        if (!isBound_[id])
+        {
+            awake_.insert(awake_.end(), id);
+        }
+    }
+}
+
+bool RelationScheduler::next(std::size_t &id)
+{
+    if (awake_.empty())
+    {
+        return false;
+    }
+    auto it = awake_.lower_bound(cursor_);
+    id = it == awake_.end() ? *awake_.begin() : *it;
+    cursor_ = id + 1;
+    return true;
+}
+
+std::size_t bindScheduled(Diagramm &diagramm,
+                          const std::vector<std::vector<GroupElement>> &words,
+                          RelationScheduler &scheduler,
+                          std::size_t limit,
+                          const std::function<void()> &onBound,
+                          const std::function<bool()> &stopped)
+{
+    std::size_t bound = 0;
+    bool isAdditionForced = false;
+    // All relations which may bind without force were tried since last bind
+    bool mayForce = true;
+    while (bound < limit && !stopped())
+    {
+        std::size_t id;
+        if (!scheduler.next(id))
+        {
+            if (isAdditionForced)
+            {
+                break; // Forced pass over all relations bound nothing
+            }
+            // Binds could also unblock relations by consuming boundary near
+            // their longest match, so pass over all of them without force,
+            // force only after such pass binds nothing
+            isAdditionForced = mayForce;
+            scheduler.wakeAll();
+            mayForce = true;
+            continue;
+        }
+        if (!diagramm.bindWord(words[id], isAdditionForced, false))
+        {
+            scheduler.failed(id);
+            continue;
+        }
+        scheduler.bound(id);
+        ++bound;
+        onBound();
+        if (isAdditionForced)
+        {
+            // Forced bind may let others bind normally: those which may
+            // match exposed segment are retried without force, then the
+            // forced pass goes on
+            isAdditionForced = false;
+            scheduler.sleepAll();
+        }
+        else
+        {
+            mayForce = false;
+        }
+        scheduler.expose(diagramm.exposedSegment());
+    }
+    return bound;
+}
+} // namespace van_kampen
@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+#include "ResultCache.hpp"
+#include "Utility.hpp"
+
+namespace van_kampen
+{
+namespace
+{
+const char entryMagic[] = "VKCACHE5";
+const char entryExtension[] = ".vkd";
+
+// FNV-1a hash, continues from previous value
+std::uint64_t fnv1a(const char *data, std::size_t size, std::uint64_t hash = 14695981039346656037ULL)
+{
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+} // namespace
+
+ResultCache::ResultCache(const std::filesystem::path &directory, std::uintmax_t maxBytes)
+    : directory_(directory),
+      maxBytes_(maxBytes)
+{
+    std::filesystem::create_directories(directory_);
+}
+
+std::string ResultCache::makeKey(const std::vector<std::vector<GroupElement>> &words,
+                                 const std::string &parameters)
+{
+    // Names are prefixed with their lengths, so different inputs never give equal keys
+    std::string key = std::to_string(parameters.size()) + ":" + parameters;
+    for (const auto &word : words)
+    {
+        for (const GroupElement &letter : word)
+        {
+            key += std::to_string(letter.name.size()) + ":" + letter.name + (letter.reversed ? "-" : "+");
+        }
+        key += ",";
+    }
+    return key;
+}
+
+std::filesystem::path ResultCache::entryPath(const std::string &key) const
+{
+    std::ostringstream name;
+    name << std::hex;
+    name.width(16);
+    name.fill('0');
+    name << fnv1a(key.data(), key.size());
+    return directory_ / (name.str() + entryExtension);
+}
+
+bool ResultCache::load(const std::string &key, Diagramm &diagramm) const
+{
+    std::ifstream file(entryPath(key), std::ios::binary);
+    if (!file.good())
+    {
+        return false;
+    }
+    std::string entry((std::istreambuf_iterator<char>(file)),
+                      std::istreambuf_iterator<char>());
+    std::size_t headerSize = sizeof(entryMagic) - 1 + sizeof(std::uint64_t);
+    if (entry.size() < headerSize || std::memcmp(entry.data(), entryMagic, sizeof(entryMagic) - 1) != 0)
+    {
+        return false;
+    }
+    std::uint64_t checksum;
+    std::memcpy(&checksum, entry.data() + sizeof(entryMagic) - 1, sizeof(checksum));
+    if (checksum != fnv1a(entry.data() + headerSize, entry.size() - headerSize))
+    {
+        return false;
+    }
+
+    // Different keys may share entry file name, so key of entry is compared in full
+    std::istringstream payload(entry.substr(headerSize));
+    if (utility::readRaw<std::string>(payload) != key)
+    {
+        return false;
+    }
+    diagramm.readBinary(payload);
+
+    std::error_code ignored;
+    std::filesystem::last_write_time(entryPath(key), std::filesystem::file_time_type::clock::now(), ignored);
+    return true;
+}
+
+void ResultCache::store(const std::string &key, const Diagramm &diagramm)
+{
+    std::ostringstream payload;
+    utility::writeRaw(payload, key);
+    diagramm.writeBinary(payload);
+    std::string data = payload.str();
+
+    std::random_device random;
+    std::filesystem::path temporary = entryPath(key);
+    temporary += "." + std::to_string(random()) + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        file.write(entryMagic, sizeof(entryMagic) - 1);
+        utility::writeRaw(file, fnv1a(data.data(), data.size()));
+        file.write(data.data(), data.size());
+        if (!file.good())
+        {
+            std::error_code ignored;
+            std::filesystem::remove(temporary, ignored);
+            throw std::runtime_error("can not write cache entry to '" + temporary.string() + "'");
+        }
+    }
+    std::filesystem::rename(temporary, entryPath(key));
+    evict();
+}
+
+void ResultCache::evict()
+{
+    struct Entry
+    {
+        std::filesystem::path path;
+        std::uintmax_t size;
+        std::filesystem::file_time_type lastUse;
+    };
+    std::vector<Entry> entries;
+    std::uintmax_t totalSize = 0;
+    std::error_code error;
+    for (const auto &file : std::filesystem::directory_iterator(directory_, error))
+    {
+        if (file.path().extension() != entryExtension)
+        {
+            continue;
+        }
+        std::uintmax_t size = file.file_size(error);
+        if (error)
+        {
+            continue; // Evicted by another process
+        }
+        entries.push_back({file.path(), size, file.last_write_time(error)});
+        totalSize += size;
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.lastUse < b.lastUse;
+    });
+    for (const Entry &entry : entries)
+    {
+        if (totalSize <= maxBytes_)
+        {
+            break;
+        }
+        std::filesystem::remove(entry.path, error);
+        totalSize -= entry.size;
+    }
+}
+} // namespace van_kampen
@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <chrono>
+#include <queue>
+#include <unordered_map>
+
+#include "ConcurrentGraphBuilder.hpp"
+#include "RelationScheduler.hpp"
+#include "ShardedAlgorithm.hpp"
+#include "Utility.hpp"
+#include "VanKampenUtils.hpp"
+
+namespace van_kampen
+{
+namespace
+{
+using words_t = std::vector<std::vector<GroupElement>>;
+
+// Closes segment of hub to local relation, never occurs in real relations
+const GroupElement segmentEnd{"#segment", false};
+
+std::string letterKey(const GroupElement &letter)
+{
+    return letter.reversed ? letter.name + "!" : letter.name;
+}
+
+std::string pairKey(const GroupElement &first, const GroupElement &second)
+{
+    return letterKey(first) + ' ' + letterKey(second);
+}
+
+// Returns segment of every relation except hub, segments count if none
+// Relation is assigned to segment if it may glue along its hub 2-grams (letters
+// for squares) or along relations already assigned to it, in breadth first
+// order from all segments
+std::vector<std::size_t> assignRelations(const words_t &words, const std::vector<std::size_t> &bounds)
+{
+    std::size_t segments = bounds.size() - 1;
+    std::size_t relations = words.size() - 1;
+    std::unordered_map<std::string, std::vector<std::size_t>> byKey;
+    auto index = [&](const std::string &key, std::size_t id) {
+        auto &ids = byKey[key];
+        if (ids.empty() || ids.back() != id)
+        {
+            ids.push_back(id);
+        }
+    };
+    for (std::size_t id = 0; id < relations; ++id)
+    {
+        const auto &word = words[id];
+        for (std::size_t i = 0; i < word.size(); ++i)
+        {
+            index(pairKey(word[i], word[(i + 1) % word.size()]), id);
+            if (word.size() == 4)
+            {
+                index(letterKey(word[i]), id); // Squares may glue along one letter
+            }
+        }
+    }
+
+    std::vector<std::size_t> owner(relations, segments);
+    std::queue<std::size_t> queue;
+    auto claim = [&](const std::string &key, std::size_t segment) {
+        auto it = byKey.find(key);
+        if (it == byKey.end())
+        {
+            return;
+        }
+        for (std::size_t id : it->second)
+        {
+            if (owner[id] == segments)
+            {
+                owner[id] = segment;
+                queue.push(id);
+            }
+        }
+    };
+    // Word glues along boundary pair (a, b) with its pair (b^-1, a^-1)
+    auto claimAlong = [&](const GroupElement &a, const GroupElement &b, std::size_t segment) {
+        claim(pairKey(b.inversed(), a.inversed()), segment);
+        claim(letterKey(a.inversed()), segment);
+    };
+    const auto &hub = words.back();
+    for (std::size_t segment = 0; segment < segments; ++segment)
+    {
+        for (std::size_t i = bounds[segment]; i + 1 < bounds[segment + 1]; ++i)
+        {
+            claimAlong(hub[i], hub[i + 1], segment);
+        }
+    }
+    while (!queue.empty())
+    {
+        std::size_t id = queue.front();
+        queue.pop();
+        const auto &word = words[id];
+        for (std::size_t i = 0; i < word.size(); ++i)
+        {
+            claimAlong(word[i], word[(i + 1) % word.size()], owner[id]);
+        }
+    }
+    return owner;
+}
+
+// Bind words with ids in passes without force until none of them binds or limit is reached
+// Returns number of bound words
+template <typename Stopped>
+std::size_t bindInPasses(Diagramm &diagramm,
+                         const words_t &words,
+                         const std::vector<std::size_t> &ids,
+                         std::vector<char> &isBound,
+                         std::size_t limit,
+                         Stopped stopped)
+{
+    std::size_t bound = 0;
+    bool increase = true;
+    while (increase && bound < limit && !stopped())
+    {
+        increase = false;
+        for (std::size_t id : ids)
+        {
+            if (bound >= limit || stopped())
+            {
+                break;
+            }
+            if (isBound[id] || !diagramm.bindWord(words[id], false, false))
+            {
+                continue;
+            }
+            isBound[id] = true;
+            increase = true;
+            ++bound;
+        }
+    }
+    return bound;
+}
+} // namespace
+
+ShardedAlgorithm::ShardedAlgorithm()
+    : diagramm_(graph_) {}
+
+void ShardedAlgorithm::generate(const std::vector<std::vector<GroupElement>> &words)
+{
+    const auto &hub = words.back();
+    std::size_t relations = words.size() - 1;
+    std::size_t totalIterations = words.size();
+    if (cellsLimit)
+    {
+        totalIterations = std::min(totalIterations, cellsLimit);
+    }
+    std::size_t threadsCount = threads ? threads : utility::defaultThreadsCount();
+    std::size_t segments = std::clamp<std::size_t>(shards ? shards : threadsCount,
+                                                   1,
+                                                   std::max<std::size_t>(1, hub.size() / 2));
+    std::vector<std::size_t> bounds(segments + 1);
+    for (std::size_t segment = 0; segment <= segments; ++segment)
+    {
+        bounds[segment] = hub.size() * segment / segments;
+    }
+
+    // Same order as iterative algorithm: from the last relation to the first one
+    std::vector<std::size_t> owner = assignRelations(words, bounds);
+    std::vector<std::vector<std::size_t>> assigned(segments);
+    for (std::size_t id = relations; id-- > 0;)
+    {
+        if (owner[id] < segments)
+        {
+            assigned[owner[id]].push_back(id);
+        }
+    }
+
+    auto stopped = [this]() { return isStopped(); };
+    std::vector<char> isBound(words.size(), false);
+    isBound[relations] = true; // Hub
+    std::vector<std::shared_ptr<Graph>> localGraphs(segments);
+    std::vector<std::size_t> localUsed(segments);
+    std::vector<CellLog> localCells(segments);
+    std::vector<std::chrono::nanoseconds> localMatching(segments);
+    utility::parallelFor(segments, threadsCount, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t segment = begin; segment < end; ++segment)
+        {
+            localGraphs[segment] = std::make_shared<Graph>();
+            Diagramm local(localGraphs[segment]);
+            std::vector<GroupElement> base(hub.begin() + bounds[segment], hub.begin() + bounds[segment + 1]);
+            base.push_back(segmentEnd);
+            local.bindWord(base, false, true);
+            std::size_t budget = (totalIterations - 1) * assigned[segment].size() / std::max<std::size_t>(1, relations);
+            localUsed[segment] = bindInPasses(local, words, assigned[segment], isBound, budget, stopped);
+            localCells[segment] = local.cells();
+            localMatching[segment] = local.matchingTime();
+        }
+    });
+
+    // Local node 0 starts segment and is its terminal, local node with id equal
+    // to segment length ends it; edges along segmentEnd are dropped
+    // Segments are stitched in parallel: segment starts are shared, other
+    // nodes get ids from their segment thread, then every segment copies
+    // transitions of its own nodes and of its start
+    ConcurrentGraphBuilder builder;
+    std::vector<std::vector<nodeId_t>> globalId(segments);
+    std::vector<nodeId_t> segmentStart(segments);
+    for (nodeId_t &start : segmentStart)
+    {
+        start = builder.addNode();
+    }
+    utility::parallelFor(segments, threadsCount, [&](std::size_t begin, std::size_t end, std::size_t) {
+        auto allocator = builder.allocator();
+        for (std::size_t segment = begin; segment < end; ++segment)
+        {
+            std::size_t segmentEndNode = bounds[segment + 1] - bounds[segment];
+            globalId[segment].resize(localGraphs[segment]->nodes().size());
+            globalId[segment][0] = segmentStart[segment];
+            for (std::size_t v = 1; v < globalId[segment].size(); ++v)
+            {
+                globalId[segment][v] = v != segmentEndNode ? allocator.addNode() : segmentStart[(segment + 1) % segments];
+            }
+        }
+    });
+    auto copyTransitions = [&](std::size_t segment, nodeId_t v, std::size_t begin, std::size_t end) {
+        const auto &transitions = localGraphs[segment]->node(v).transitions();
+        transitionList_t &copy = builder.transitions(globalId[segment][v]);
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            copy.push_back(transitions[i]);
+            copy.back().to = globalId[segment][transitions[i].to];
+        }
+    };
+    utility::parallelFor(segments, threadsCount, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t segment = begin; segment < end; ++segment)
+        {
+            std::size_t previous = (segment + segments - 1) % segments;
+            nodeId_t previousEnd = bounds[previous + 1] - bounds[previous];
+            // Clockwise order at segment start: cells of previous segment, then cells of this one
+            copyTransitions(previous, previousEnd, 0, localGraphs[previous]->node(previousEnd).transitions().size() - 1);
+            copyTransitions(segment, 0, 1, localGraphs[segment]->node(0).transitions().size());
+            nodeId_t segmentEndNode = bounds[segment + 1] - bounds[segment];
+            for (std::size_t v = 1; v < localGraphs[segment]->nodes().size(); ++v)
+            {
+                if (static_cast<nodeId_t>(v) != segmentEndNode)
+                {
+                    copyTransitions(segment, v, 0, localGraphs[segment]->node(v).transitions().size());
+                }
+            }
+        }
+    });
+    localGraphs.clear();
+    std::vector<nodeId_t> builtId = builder.build(*graph_, segmentStart[0], threadsCount);
+    for (auto &ids : globalId)
+    {
+        for (nodeId_t &v : ids)
+        {
+            v = builtId[v];
+        }
+    }
+
+    // Hub is the first cell, then cells of segments without segments themselves
+    CellLog cells;
+    std::vector<nodeId_t> walk;
+    for (std::size_t segment = 0; segment < segments; ++segment)
+    {
+        auto begin = globalId[segment].begin();
+        walk.insert(walk.end(), begin, begin + (bounds[segment + 1] - bounds[segment]));
+    }
+    cells.add(walk.begin(), walk.end());
+    std::size_t used = 1;
+    for (std::size_t segment = 0; segment < segments; ++segment)
+    {
+        used += localUsed[segment];
+        const CellLog &local = localCells[segment];
+        for (std::size_t cell = 1; cell < local.size(); ++cell)
+        {
+            walk.clear();
+            for (std::size_t i = local.offsets[cell]; i < local.offsets[cell + 1]; ++i)
+            {
+                walk.push_back(globalId[segment][local.nodes[i]]);
+            }
+            cells.add(walk.begin(), walk.end());
+        }
+    }
+    localCells.clear();
+    diagramm_.setTerminal(builtId[segmentStart[0]]);
+    diagramm_.setCells(std::move(cells));
+    diagramm_.setMatchingThreads(threadsCount);
+    for (std::chrono::nanoseconds time : localMatching)
+    {
+        diagramm_.addMatchingTime(time);
+    }
+
+    // Relations which conflicted near segment borders or were not assigned
+    RelationScheduler scheduler(words);
+    std::size_t left = 0;
+    for (std::size_t id = 0; id < words.size(); ++id)
+    {
+        if (isBound[id])
+        {
+            scheduler.bound(id);
+        }
+        else
+        {
+            ++left;
+        }
+    }
+    if (!quiet)
+    {
+        std::clog << "Segments: " << segments << ", relations used on them: " << used - 1
+                  << ", relations left: " << left << std::endl;
+    }
+    ProcessLogger logger(totalIterations, std::clog, "Relations used", quiet);
+    for (std::size_t i = 0; i < used; ++i)
+    {
+        logger.iterate();
+    }
+    cellsBound(used); // Segments are reported at once, when they are stitched
+    used += bindScheduled(
+        diagramm_, words, scheduler, totalIterations - used,
+        [&]() {
+            logger.iterate();
+            cellsBound();
+        },
+        stopped);
+    if (used < totalIterations && !quiet)
+    {
+        std::clog << "can not bind " << totalIterations - used << " relations, finishing";
+    }
+}
+
+Diagramm &ShardedAlgorithm::diagramm()
+{
+    return diagramm_;
+}
+} // namespace van_kampen
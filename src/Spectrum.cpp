@@ -0,0 +1,513 @@
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+#include "CsrGraph.hpp"
+#include "Spectrum.hpp"
+#include "Utility.hpp"
+
+namespace van_kampen
+{
+namespace
+{
+// Laplacian L = D - A of graph restricted to alive nodes
+// Its kernel is spanned by constant vectors of connected components
+class Laplacian
+{
+public:
+    Laplacian(const Graph &graph, std::size_t threads)
+        : adjacency_(graph), alive_(adjacency_.size()), component_(adjacency_.size(), noComponent), threads_(threads)
+    {
+        for (std::size_t v = 0; v < alive_.size(); ++v)
+        {
+            alive_[v] = !graph.isRemoved(v);
+        }
+        std::vector<std::size_t> queue;
+        for (std::size_t root = 0; root < size(); ++root)
+        {
+            if (!alive_[root] || component_[root] != noComponent)
+            {
+                continue;
+            }
+            component_[root] = componentSizes_.size();
+            queue.assign(1, root);
+            for (std::size_t head = 0; head < queue.size(); ++head)
+            {
+                std::size_t v = queue[head];
+                for (std::size_t e = adjacency_.offsets[v]; e < adjacency_.offsets[v + 1]; ++e)
+                {
+                    std::size_t u = adjacency_.adjacent[e];
+                    if (component_[u] == noComponent)
+                    {
+                        component_[u] = componentSizes_.size();
+                        queue.push_back(u);
+                    }
+                }
+            }
+            componentSizes_.push_back(queue.size());
+        }
+    }
+
+    std::size_t size() const noexcept { return adjacency_.size(); }
+    bool alive(std::size_t v) const noexcept { return alive_[v]; }
+    std::size_t threads() const noexcept { return threads_; }
+
+    // Returns number of connected components, multiplicity of zero eigenvalue
+    std::size_t components() const noexcept { return componentSizes_.size(); }
+
+    // Project x out of kernel: subtract mean of every component
+    void deflate(std::vector<double> &x) const
+    {
+        std::vector<double> sums(components(), 0.0);
+        for (std::size_t v = 0; v < size(); ++v)
+        {
+            if (alive_[v])
+            {
+                sums[component_[v]] += x[v];
+            }
+        }
+        for (std::size_t v = 0; v < size(); ++v)
+        {
+            if (alive_[v])
+            {
+                x[v] -= sums[component_[v]] / componentSizes_[component_[v]];
+            }
+        }
+    }
+
+    // Solve L x = b for b orthogonal to kernel with Jacobi preconditioned
+    // conjugate gradient, x is orthogonal to kernel too
+    // Returns if residual fell below tolerance within iterations limit
+    bool solve(const std::vector<double> &b, std::vector<double> &x, std::size_t iterations) const
+    {
+        const double tolerance = 1e-8;
+        std::vector<double> r = b, z(size()), p(size()), q(size());
+        std::vector<double> partialRr(std::max<std::size_t>(1, threads_)), partialRz(partialRr.size());
+        double rr = 0.0, rz = 0.0;
+        // x += step * p, r -= step * q, z = r / degree and both residual
+        // products in one pass
+        auto update = [&](double step) {
+            utility::parallelFor(size(), threads_, [&](std::size_t begin, std::size_t end, std::size_t chunk) {
+                double sumRr = 0.0, sumRz = 0.0;
+                for (std::size_t v = begin; v < end; ++v)
+                {
+                    x[v] += step * p[v];
+                    r[v] -= step * q[v];
+                    std::size_t degree = adjacency_.degree(v);
+                    z[v] = degree ? r[v] / static_cast<double>(degree) : 0.0;
+                    sumRr += r[v] * r[v];
+                    sumRz += r[v] * z[v];
+                }
+                partialRr[chunk] = sumRr;
+                partialRz[chunk] = sumRz;
+            });
+            rr = std::accumulate(partialRr.begin(), partialRr.end(), 0.0);
+            return std::accumulate(partialRz.begin(), partialRz.end(), 0.0);
+        };
+        x.assign(size(), 0.0);
+        rz = update(0.0);
+        double bound = tolerance * tolerance * rr;
+        p = z;
+        bool converged = rr <= bound;
+        for (std::size_t iteration = 0; iteration < iterations && !converged; ++iteration)
+        {
+            multiply(p, q);
+            double next = update(rz / dot(p, q));
+            converged = rr <= bound;
+            utility::parallelFor(size(), threads_, [&](std::size_t begin, std::size_t end, std::size_t) {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    p[i] = z[i] + next / rz * p[i];
+                }
+            });
+            rz = next;
+        }
+        deflate(x);
+        return converged;
+    }
+
+    // result = L * x
+    void multiply(const std::vector<double> &x, std::vector<double> &result) const
+    {
+        utility::parallelFor(size(), threads_, [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t v = begin; v < end; ++v)
+            {
+                double sum = static_cast<double>(adjacency_.degree(v)) * x[v];
+                for (std::size_t e = adjacency_.offsets[v]; e < adjacency_.offsets[v + 1]; ++e)
+                {
+                    sum -= x[adjacency_.adjacent[e]];
+                }
+                result[v] = sum;
+            }
+        });
+    }
+
+    double dot(const std::vector<double> &a, const std::vector<double> &b) const
+    {
+        std::vector<double> partial(std::max<std::size_t>(1, threads_));
+        utility::parallelFor(size(), threads_, [&](std::size_t begin, std::size_t end, std::size_t chunk) {
+            double sum = 0.0;
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                sum += a[i] * b[i];
+            }
+            partial[chunk] = sum;
+        });
+        return std::accumulate(partial.begin(), partial.end(), 0.0);
+    }
+
+    // y += coef * x
+    void axpy(double coef, const std::vector<double> &x, std::vector<double> &y) const
+    {
+        utility::parallelFor(size(), threads_, [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                y[i] += coef * x[i];
+            }
+        });
+    }
+
+private:
+    static const std::size_t noComponent = static_cast<std::size_t>(-1);
+
+    CsrGraph adjacency_;
+    std::vector<char> alive_;
+    std::vector<std::size_t> component_; // Component of every alive node
+    std::vector<std::size_t> componentSizes_;
+    std::size_t threads_;
+};
+
+// Symmetric tridiagonal matrix built by Lanczos iterations
+struct Tridiagonal
+{
+    std::vector<double> alpha; // Diagonal
+    std::vector<double> beta;  // Subdiagonal, beta[i] is between i and i + 1
+    double residual = 0.0;     // Norm of the next Lanczos vector, Ritz residuals are its multiples
+};
+
+// Ritz value with bound of its relative error
+struct RitzValue
+{
+    double value, relativeResidual;
+};
+
+// Run Lanczos iterations of symmetric operator from unit vector start,
+// multiply(x, y) sets y to operator times x and returns if it succeeded
+// With reorthogonalize all basis vectors are stored and kept orthogonal
+// Every checkInterval steps run stops if stop(tridiagonal) returns true
+template <typename Multiply, typename Stop>
+Tridiagonal lanczos(const Laplacian &laplacian, Multiply &&multiply, std::vector<double> start, std::size_t steps,
+                    bool reorthogonalize, Stop &&stop)
+{
+    const std::size_t checkInterval = 5;
+    Tridiagonal result;
+    std::vector<std::vector<double>> basis;
+    std::vector<double> current = std::move(start), previous(laplacian.size()), next(laplacian.size());
+    double previousBeta = 0.0;
+    for (std::size_t step = 0; step < steps; ++step)
+    {
+        if (!multiply(current, next))
+        {
+            // Run ends on the previous step
+            if (!result.beta.empty())
+            {
+                result.residual = result.beta.back();
+                result.beta.pop_back();
+            }
+            break;
+        }
+        double alpha = laplacian.dot(next, current);
+        laplacian.axpy(-alpha, current, next);
+        laplacian.axpy(-previousBeta, previous, next);
+        result.alpha.push_back(alpha);
+        if (reorthogonalize)
+        {
+            basis.push_back(current);
+            for (const std::vector<double> &vector : basis)
+            {
+                laplacian.axpy(-laplacian.dot(next, vector), vector, next);
+            }
+        }
+        double beta = std::sqrt(laplacian.dot(next, next));
+        result.residual = beta;
+        if (step + 1 == steps || beta <= 1e-10 * std::max(1.0, std::abs(alpha)))
+        {
+            break; // Krylov subspace is invariant
+        }
+        if ((step + 1) % checkInterval == 0 && stop(result))
+        {
+            break;
+        }
+        result.beta.push_back(beta);
+        utility::parallelFor(laplacian.size(), laplacian.threads(), [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                previous[i] = current[i];
+                current[i] = next[i] / beta;
+            }
+        });
+        previousBeta = beta;
+    }
+    return result;
+}
+
+// Eigenvalues of tridiagonal matrix with first and last components of its eigenvectors
+// Implicit QL algorithm (tql2 from EISPACK), only first and last rows of eigenvectors are tracked
+void tridiagonalEigen(Tridiagonal matrix, std::vector<double> &values, std::vector<double> &firstComponents,
+                      std::vector<double> &lastComponents)
+{
+    std::size_t n = matrix.alpha.size();
+    std::vector<double> &d = matrix.alpha;
+    std::vector<double> e = matrix.beta;
+    e.resize(n, 0.0);
+    std::vector<double> z(n, 0.0), w(n, 0.0);
+    z[0] = 1.0;
+    w[n - 1] = 1.0;
+    double f = 0.0, tst1 = 0.0, eps = std::pow(2.0, -52.0);
+    for (std::size_t l = 0; l < n; ++l)
+    {
+        tst1 = std::max(tst1, std::abs(d[l]) + std::abs(e[l]));
+        std::size_t m = l;
+        while (m + 1 < n && std::abs(e[m]) > eps * tst1)
+        {
+            ++m;
+        }
+        if (m > l)
+        {
+            do
+            {
+                double g = d[l];
+                double p = (d[l + 1] - g) / (2.0 * e[l]);
+                double r = std::hypot(p, 1.0);
+                if (p < 0)
+                {
+                    r = -r;
+                }
+                d[l] = e[l] / (p + r);
+                d[l + 1] = e[l] * (p + r);
+                double dl1 = d[l + 1];
+                double h = g - d[l];
+                for (std::size_t i = l + 2; i < n; ++i)
+                {
+                    d[i] -= h;
+                }
+                f += h;
+                p = d[m];
+                double c = 1.0, c2 = 1.0, c3 = 1.0;
+                double el1 = e[l + 1];
+                double s = 0.0, s2 = 0.0;
+                for (std::size_t i = m; i-- > l;)
+                {
+                    c3 = c2;
+                    c2 = c;
+                    s2 = s;
+                    g = c * e[i];
+                    h = c * p;
+                    r = std::hypot(p, e[i]);
+                    e[i + 1] = s * r;
+                    s = e[i] / r;
+                    c = p / r;
+                    p = c * d[i] - s * g;
+                    d[i + 1] = h + s * (c * g + s * d[i]);
+                    h = z[i + 1];
+                    z[i + 1] = s * z[i] + c * h;
+                    z[i] = c * z[i] - s * h;
+                    h = w[i + 1];
+                    w[i + 1] = s * w[i] + c * h;
+                    w[i] = c * w[i] - s * h;
+                }
+                p = -s * s2 * c3 * el1 * e[l] / dl1;
+                e[l] = s * p;
+                d[l] = c * p;
+            } while (std::abs(e[l]) > eps * tst1);
+        }
+        d[l] += f;
+        e[l] = 0.0;
+    }
+    values = d;
+    firstComponents = z;
+    lastComponents = w;
+}
+
+// Ritz values of run whose relative residual bound is not above tolerance, ascending
+// Residual of Ritz pair is residual of run times last component of its eigenvector
+std::vector<RitzValue> convergedRitzValues(const Tridiagonal &matrix, double tolerance)
+{
+    std::vector<RitzValue> result;
+    if (matrix.alpha.empty())
+    {
+        return result;
+    }
+    std::vector<double> values, first, last;
+    tridiagonalEigen(matrix, values, first, last);
+    for (std::size_t j = 0; j < values.size(); ++j)
+    {
+        double relative = matrix.residual * std::abs(last[j]) / std::max(std::abs(values[j]), 1e-300);
+        if (relative <= tolerance)
+        {
+            result.push_back(RitzValue{values[j], relative});
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const RitzValue &a, const RitzValue &b) { return a.value < b.value; });
+    return result;
+}
+
+// Random unit vector with +-1 entries on alive nodes
+std::vector<double> randomStart(const Laplacian &laplacian, std::mt19937_64 &random)
+{
+    std::vector<double> start(laplacian.size(), 0.0);
+    std::size_t alive = 0;
+    for (std::size_t v = 0; v < start.size(); ++v)
+    {
+        if (laplacian.alive(v))
+        {
+            start[v] = (random() & 1) ? 1.0 : -1.0;
+            ++alive;
+        }
+    }
+    for (double &x : start)
+    {
+        x /= std::sqrt(static_cast<double>(alive));
+    }
+    return start;
+}
+} // namespace
+
+SpectrumReport analyzeSpectrum(const Graph &graph, const SpectrumParameters &parameters)
+{
+    SpectrumReport report;
+    Laplacian laplacian(graph, parameters.threads);
+    for (std::size_t v = 0; v < laplacian.size(); ++v)
+    {
+        report.nodes += laplacian.alive(v);
+    }
+    if (report.nodes == 0)
+    {
+        return report;
+    }
+    std::size_t steps = std::min(parameters.lanczosSteps, report.nodes);
+    std::mt19937_64 random(parameters.seed);
+
+    auto multiply = [&](const std::vector<double> &x, std::vector<double> &y) {
+        laplacian.multiply(x, y);
+        return true;
+    };
+    auto noStop = [](const Tridiagonal &) { return false; };
+
+    std::vector<std::vector<double>> ritzValues, weights;
+    std::size_t probes = std::max<std::size_t>(1, parameters.probes);
+    for (std::size_t probe = 0; probe < probes; ++probe)
+    {
+        Tridiagonal matrix = lanczos(laplacian, multiply, randomStart(laplacian, random), steps, probe == 0, noStop);
+        std::vector<double> values, components, last;
+        tridiagonalEigen(matrix, values, components, last);
+        ritzValues.push_back(values);
+        weights.emplace_back();
+        for (double component : components)
+        {
+            weights.back().push_back(component * component);
+        }
+    }
+
+    // Run is long enough when wanted number of the largest Ritz values
+    // has converged
+    auto converges = [&](std::size_t wanted) {
+        return [&parameters, wanted](const Tridiagonal &matrix) {
+            std::vector<RitzValue> converged = convergedRitzValues(matrix, parameters.tolerance);
+            return converged.size() >= wanted && converged[converged.size() - wanted].value > 0.0;
+        };
+    };
+    std::size_t extremeSteps = std::min(parameters.extremeSteps, report.nodes);
+
+    // Largest Ritz values of reorthogonalized run converge to largest eigenvalues
+    std::size_t count = std::min(parameters.extremeCount, report.nodes);
+    if (count)
+    {
+        std::vector<RitzValue> converged = convergedRitzValues(
+            lanczos(laplacian, multiply, randomStart(laplacian, random), extremeSteps, true, converges(count)),
+            parameters.tolerance);
+        for (auto it = converged.end() - std::min(count, converged.size()); it != converged.end(); ++it)
+        {
+            report.largest.push_back(it->value);
+            report.largestResiduals.push_back(it->relativeResidual);
+        }
+    }
+
+    // Smallest eigenvalues are clustered near zero, so Lanczos on L finds
+    // them slowly; zero ones are known from components, the rest are
+    // inverses of the largest eigenvalues of L^-1 on kernel complement
+    std::size_t zeros = std::min(parameters.extremeCount, laplacian.components());
+    report.smallest.assign(zeros, 0.0);
+    report.smallestResiduals.assign(zeros, 0.0);
+    std::size_t wanted = parameters.extremeCount - zeros;
+    std::vector<double> start = randomStart(laplacian, random);
+    laplacian.deflate(start);
+    double norm = std::sqrt(laplacian.dot(start, start));
+    if (wanted && norm > 0.0)
+    {
+        for (double &x : start)
+        {
+            x /= norm;
+        }
+        auto inverse = [&](const std::vector<double> &x, std::vector<double> &y) {
+            return laplacian.solve(x, y, parameters.solverIterations);
+        };
+        std::size_t inverseSteps = std::min(extremeSteps, report.nodes - laplacian.components());
+        std::vector<RitzValue> converged = convergedRitzValues(
+            lanczos(laplacian, inverse, start, inverseSteps, true, converges(wanted)),
+            parameters.tolerance);
+        for (auto it = converged.rbegin(); it != converged.rend() && report.smallest.size() < parameters.extremeCount; ++it)
+        {
+            if (it->value > 0.0)
+            {
+                report.smallest.push_back(1.0 / it->value);
+                report.smallestResiduals.push_back(it->relativeResidual);
+            }
+        }
+    }
+
+    // Stochastic Lanczos quadrature: eigenvalue density is mixture of Ritz values weighted by
+    // squared first components of tridiagonal eigenvectors
+    double upper = 0.0;
+    for (const auto &values : ritzValues)
+    {
+        upper = std::max(upper, *std::max_element(values.begin(), values.end()));
+    }
+    std::size_t bins = std::max<std::size_t>(1, parameters.bins);
+    report.histogramBegin = 0.0;
+    report.binWidth = std::max(upper, 1e-9) * (1.0 + 1e-9) / bins;
+    report.histogram.assign(bins, 0.0);
+    for (std::size_t probe = 0; probe < probes; ++probe)
+    {
+        for (std::size_t j = 0; j < ritzValues[probe].size(); ++j)
+        {
+            double position = (ritzValues[probe][j] - report.histogramBegin) / report.binWidth;
+            std::size_t bin = static_cast<std::size_t>(std::clamp(position, 0.0, static_cast<double>(bins - 1)));
+            report.histogram[bin] += weights[probe][j] * report.nodes / probes;
+        }
+    }
+    return report;
+}
+
+void printSpectrum(const SpectrumReport &report, std::ostream &os)
+{
+    os << "# Laplacian spectrum of graph with " << report.nodes << " nodes\n";
+    os << "# smallest eigenvalues: index value relative-residual\n";
+    for (std::size_t i = 0; i < report.smallest.size(); ++i)
+    {
+        os << i << ' ' << report.smallest[i] << ' ' << report.smallestResiduals[i] << '\n';
+    }
+    os << "\n\n# largest eigenvalues: index value relative-residual\n";
+    for (std::size_t i = 0; i < report.largest.size(); ++i)
+    {
+        os << i << ' ' << report.largest[i] << ' ' << report.largestResiduals[i] << '\n';
+    }
+    os << "\n\n# histogram: bin center, estimated eigenvalues count\n";
+    for (std::size_t i = 0; i < report.histogram.size(); ++i)
+    {
+        os << report.histogramBegin + (i + 0.5) * report.binWidth << ' ' << report.histogram[i] << '\n';
+    }
+    os.flush();
+}
+} // namespace van_kampen
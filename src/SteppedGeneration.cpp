@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include "SteppedGeneration.hpp"
+
+namespace van_kampen
+{
+SteppedGeneration::SteppedGeneration(std::unique_ptr<DiagrammGeneratingAlgorithm> algorithm,
+                                     std::vector<std::vector<GroupElement>> words)
+    : algorithm_(std::move(algorithm)), words_(std::move(words))
+{
+    if (!algorithm_)
+    {
+        throw std::invalid_argument("no algorithm to generate with");
+    }
+    algorithm_->stop = &cancelled_;
+    algorithm_->onCellsBound = [this](std::size_t count) { suspend(count); };
+    worker_ = std::thread([this]() {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this]() { return running_; });
+        }
+        std::exception_ptr error;
+        try
+        {
+            algorithm_->generate(words_);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        error_ = error;
+        finished_ = true;
+        running_ = false;
+        wake_.notify_all();
+    });
+}
+
+SteppedGeneration::~SteppedGeneration()
+{
+    if (worker_.joinable())
+    {
+        cancelled_ = true;
+        resume(std::numeric_limits<std::size_t>::max());
+        worker_.join();
+    }
+}
+
+GenerationProgress SteppedGeneration::step(std::size_t budget)
+{
+    resume(std::max<std::size_t>(1, budget));
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::swap(error, error_);
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    return progress();
+}
+
+void SteppedGeneration::cancel()
+{
+    cancelled_ = true;
+    resume(std::numeric_limits<std::size_t>::max());
+}
+
+bool SteppedGeneration::finished() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return finished_;
+}
+
+GenerationProgress SteppedGeneration::progress()
+{
+    if (!algorithm_)
+    {
+        throw std::logic_error("algorithm is released");
+    }
+    GenerationProgress progress;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        progress.bound = bound_;
+        progress.finished = finished_;
+    }
+    // Algorithm is suspended, so diagram is not changed meanwhile
+    progress.cells = algorithm_->diagramm().cellsCount();
+    progress.boundary = algorithm_->diagramm().getCircuit().size();
+    return progress;
+}
+
+DiagrammGeneratingAlgorithm &SteppedGeneration::algorithm() noexcept
+{
+    return *algorithm_;
+}
+
+std::unique_ptr<DiagrammGeneratingAlgorithm> SteppedGeneration::release()
+{
+    if (!finished())
+    {
+        throw std::logic_error("generation is not finished");
+    }
+    worker_.join();
+    algorithm_->stop = nullptr;
+    algorithm_->onCellsBound = nullptr;
+    return std::move(algorithm_);
+}
+
+void SteppedGeneration::resume(std::size_t budget)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (finished_)
+    {
+        return;
+    }
+    budget_ = budget;
+    running_ = true;
+    wake_.notify_all();
+    wake_.wait(lock, [this]() { return !running_; });
+}
+
+void SteppedGeneration::suspend(std::size_t count)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    bound_ += count;
+    budget_ -= std::min(budget_, count);
+    if (budget_ == 0)
+    {
+        running_ = false;
+        wake_.notify_all();
+        wake_.wait(lock, [this]() { return running_; });
+    }
+}
+} // namespace van_kampen
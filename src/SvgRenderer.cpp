@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <limits>
+
+#include "BufferedWriter.hpp"
+#include "SvgRenderer.hpp"
+
+namespace van_kampen
+{
+namespace
+{
+const double pixelsPerUnit = 40.0; // Layout edge length on image
+const double margin = 20.0;        // Empty space around diagram
+
+void printEscaped(BufferedWriter &out, const std::string &text)
+{
+    for (char c : text)
+    {
+        switch (c)
+        {
+        case '&':
+            out << "&amp;";
+            break;
+        case '<':
+            out << "&lt;";
+            break;
+        case '>':
+            out << "&gt;";
+            break;
+        case '"':
+            out << "&quot;";
+            break;
+        default:
+            out << c;
+        }
+    }
+}
+} // namespace
+
+void printSvg(const Graph &graph, std::ostream &os)
+{
+    if (!graph.isPositioned())
+    {
+        throw std::logic_error("can not draw svg: node positions are not computed");
+    }
+    Point low{std::numeric_limits<double>::max(), std::numeric_limits<double>::max()};
+    Point high{std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest()};
+    for (const Node &node : graph.nodes())
+    {
+        if (graph.isRemoved(node.getId()))
+        {
+            continue;
+        }
+        low = {std::min(low.x, node.position.x), std::min(low.y, node.position.y)};
+        high = {std::max(high.x, node.position.x), std::max(high.y, node.position.y)};
+    }
+    if (low.x > high.x)
+    {
+        low = high = Point{};
+    }
+    auto toImage = [&](const Point &p) {
+        return Point{(p.x - low.x) * pixelsPerUnit + margin, (high.y - p.y) * pixelsPerUnit + margin};
+    };
+    Point size = toImage(Point{high.x, low.y}) + Point{margin, margin};
+
+    BufferedWriter out(os);
+    out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << size.x << "\" height=\"" << size.y
+        << "\" viewBox=\"0 0 " << size.x << ' ' << size.y << "\">\n"
+        << "<defs><marker id=\"vee\" viewBox=\"0 0 10 10\" refX=\"10\" refY=\"5\" markerWidth=\"6\" markerHeight=\"6\" orient=\"auto\">"
+        << "<path d=\"M0,0 L10,5 L0,10 L4,5 z\"/></marker></defs>\n";
+
+    // Edges are drawn same way as in dot output: only not reversed, hub ones are thicker
+    out << "<g stroke=\"black\" marker-end=\"url(#vee)\">\n";
+    for (const Node &node : graph.nodes())
+    {
+        if (graph.isRemoved(node.getId()))
+        {
+            continue;
+        }
+        for (const Transition &tr : node.transitions())
+        {
+            if (tr.label.reversed || graph.isRemoved(tr.to))
+            {
+                continue;
+            }
+            Segment edge{toImage(node.position), toImage(graph.node(tr.to).position)};
+            out << "<line x1=\"" << edge.first.x << "\" y1=\"" << edge.first.y
+                << "\" x2=\"" << edge.second.x << "\" y2=\"" << edge.second.y << '"'
+                << (tr.isInHub ? " stroke-width=\"5\"" : "") << "/>\n";
+        }
+    }
+    out << "</g>\n<g font-family=\"sans-serif\" font-size=\"12\" text-anchor=\"middle\">\n";
+    for (const Node &node : graph.nodes())
+    {
+        if (graph.isRemoved(node.getId()))
+        {
+            continue;
+        }
+        for (const Transition &tr : node.transitions())
+        {
+            if (tr.label.reversed || graph.isRemoved(tr.to))
+            {
+                continue;
+            }
+            Point middle = middleOf(toImage(node.position), toImage(graph.node(tr.to).position));
+            out << "<text x=\"" << middle.x << "\" y=\"" << middle.y << "\">";
+            printEscaped(out, tr.label.name);
+            out << "</text>\n";
+        }
+    }
+    out << "</g>\n<g font-family=\"sans-serif\" font-size=\"12\" text-anchor=\"middle\">\n";
+    for (const Node &node : graph.nodes())
+    {
+        if (graph.isRemoved(node.getId()))
+        {
+            continue;
+        }
+        Point center = toImage(node.position);
+        if (node.isHighlighted())
+        {
+            out << "<circle cx=\"" << center.x << "\" cy=\"" << center.y << "\" r=\"8\" fill=\"white\" stroke=\"black\"/>\n";
+        }
+        else
+        {
+            out << "<circle cx=\"" << center.x << "\" cy=\"" << center.y << "\" r=\"2\"/>\n";
+        }
+        if (!node.diagramLabel().empty())
+        {
+            out << "<text x=\"" << center.x << "\" y=\"" << center.y + 4.0 << "\">";
+            printEscaped(out, node.diagramLabel());
+            out << "</text>\n";
+        }
+        if (!node.diagramComment().empty())
+        {
+            out << "<text x=\"" << center.x + 10.0 << "\" y=\"" << center.y - 10.0 << "\" text-anchor=\"start\">";
+            printEscaped(out, node.diagramComment());
+            out << "</text>\n";
+        }
+    }
+    out << "</g>\n</svg>\n";
+    out.flush();
+    os.flush();
+}
+} // namespace van_kampen
@@ -0,0 +1,305 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "Faces.hpp"
+#include "Generation.hpp"
+#include "Utility.hpp"
+#include "Verifier.hpp"
+
+namespace van_kampen
+{
+namespace
+{
+using word_t = std::vector<std::uint32_t>;
+
+struct WordHash
+{
+    std::size_t operator()(const word_t &word) const noexcept
+    {
+        std::size_t hash = word.size();
+        for (std::uint32_t letter : word)
+        {
+            hash = hash * 1000003 ^ letter;
+        }
+        return hash;
+    }
+};
+
+// Letters are numbered by names, inversed letter differs in the lowest bit
+class Alphabet
+{
+public:
+    // Returns false if name is unknown
+    bool encode(const GroupElement &letter, std::uint32_t &code) const
+    {
+        auto it = ids_.find(letter.name);
+        if (it == ids_.end())
+        {
+            return false;
+        }
+        code = it->second * 2 + letter.reversed;
+        return true;
+    }
+
+    std::uint32_t add(const GroupElement &letter)
+    {
+        auto it = ids_.emplace(letter.name, ids_.size()).first;
+        return it->second * 2 + letter.reversed;
+    }
+
+private:
+    std::unordered_map<std::string, std::uint32_t> ids_;
+};
+
+// Rotation of cyclic word which is the least lexicographically
+word_t leastRotation(const word_t &word)
+{
+    std::size_t n = word.size(), i = 0, j = 1, k = 0;
+    while (i < n && j < n && k < n)
+    {
+        std::uint32_t a = word[(i + k) % n], b = word[(j + k) % n];
+        if (a == b)
+        {
+            ++k;
+            continue;
+        }
+        (a > b ? i : j) += k + 1;
+        j += i == j;
+        k = 0;
+    }
+    std::size_t shift = n ? std::min(i, j) : 0;
+    word_t result(word.begin() + shift, word.end());
+    result.insert(result.end(), word.begin(), word.begin() + shift);
+    return result;
+}
+
+// Same for all cyclic shifts of word and of its inverse
+word_t canonical(const word_t &word)
+{
+    word_t inverse(word.rbegin(), word.rend());
+    for (std::uint32_t &letter : inverse)
+    {
+        letter ^= 1;
+    }
+    return std::min(leastRotation(word), leastRotation(inverse));
+}
+
+// First violations found by one worker, ordered by their keys
+struct Violations
+{
+    explicit Violations(std::size_t maxCount)
+        : limit(maxCount) {}
+
+    template <typename... Parts>
+    void add(std::size_t key, Parts &&... parts)
+    {
+        ++count;
+        if (found.size() < limit)
+        {
+            std::ostringstream os;
+            (os << ... << parts);
+            found.emplace_back(key, os.str());
+        }
+    }
+
+    std::size_t limit;
+    std::size_t count = 0;
+    std::vector<std::pair<std::size_t, std::string>> found;
+};
+
+std::string letterToString(const GroupElement &letter)
+{
+    return letter.name + (letter.reversed ? "^(-1)" : "");
+}
+} // namespace
+
+VerifyReport verifyDiagram(const Graph &graph,
+                           Diagramm &diagramm,
+                           const std::vector<std::vector<GroupElement>> &words,
+                           const VerifyParameters &parameters)
+{
+    const auto &nodes = graph.nodes();
+    std::size_t threads = std::max<std::size_t>(1, parameters.threads);
+    VerifyReport report;
+    Violations global(parameters.maxViolations);
+    auto exists = [&](nodeId_t v) {
+        return v >= 0 && static_cast<std::size_t>(v) < nodes.size() && !graph.isRemoved(v);
+    };
+
+    // Every transition u -> v with label has as many reversed transitions
+    // v -> u with inversed label as there are parallel ones
+    std::vector<Violations> nodeViolations(threads, Violations(parameters.maxViolations));
+    std::vector<std::size_t> nodeCounts(threads), dartCounts(threads);
+    utility::parallelFor(nodes.size(), threads, [&](std::size_t begin, std::size_t end, std::size_t chunk) {
+        Violations &violations = nodeViolations[chunk];
+        for (std::size_t u = begin; u < end; ++u)
+        {
+            if (graph.isRemoved(u))
+            {
+                continue;
+            }
+            ++nodeCounts[chunk];
+            const auto &transitions = nodes[u].transitions();
+            dartCounts[chunk] += transitions.size();
+            for (std::size_t i = 0; i < transitions.size(); ++i)
+            {
+                const Transition &tr = transitions[i];
+                if (!exists(tr.to))
+                {
+                    violations.add(u, "node ", u, ": transition ", letterToString(tr.label), " leads to missing node ", tr.to);
+                    continue;
+                }
+                auto same = [&](const Transition &other) { return other.to == tr.to && other.label == tr.label; };
+                if (std::find_if(transitions.begin(), transitions.begin() + i, same) != transitions.begin() + i)
+                {
+                    continue; // Parallel transitions are counted at the first one
+                }
+                GroupElement inversed = tr.label.inversed();
+                const auto &reversed = nodes[tr.to].transitions();
+                auto pairs = std::count_if(reversed.begin(), reversed.end(), [&](const Transition &other) {
+                    return other.to == static_cast<nodeId_t>(u) && other.label == inversed;
+                });
+                auto parallel = std::count_if(transitions.begin() + i, transitions.end(), same);
+                if (pairs != parallel)
+                {
+                    violations.add(u, "node ", u, ": ", parallel, " transitions ", letterToString(tr.label), " to node ", tr.to,
+                                   " have ", pairs, " reversed ones");
+                }
+            }
+        }
+    });
+    for (std::size_t chunk = 0; chunk < threads; ++chunk)
+    {
+        report.nodes += nodeCounts[chunk];
+        report.edges += dartCounts[chunk];
+    }
+    report.edges /= 2;
+
+    // Boundary circuit
+    nodeId_t terminal = diagramm.getTerminal();
+    std::vector<Transition> circuit;
+    if (!exists(terminal))
+    {
+        global.add(0, "terminal node ", terminal, " does not exist");
+    }
+    else
+    {
+        circuit = diagramm.getCircuit();
+        if (!circuit.empty() && circuit.back().to != terminal)
+        {
+            global.add(0, "boundary circuit of length ", circuit.size(), " is not closed");
+        }
+        if (!parameters.circuit.empty() && circuitToString(circuit) != parameters.circuit)
+        {
+            global.add(0, "boundary circuit label differs from expected one");
+        }
+    }
+
+    // Faces are compared with relations up to cyclic shift and inversion
+    Alphabet alphabet;
+    std::unordered_set<word_t, WordHash> relations;
+    for (const auto &word : words)
+    {
+        word_t code;
+        for (const GroupElement &letter : word)
+        {
+            code.push_back(alphabet.add(letter));
+        }
+        relations.insert(canonical(code));
+    }
+    FaceList faces = enumerateFaces(graph, diagramm);
+    report.faces = faces.size();
+    report.cells = diagramm.cellsCount();
+    std::vector<Violations> faceViolations(threads, Violations(parameters.maxViolations));
+    utility::parallelFor(faces.size(), threads, [&](std::size_t begin, std::size_t end, std::size_t chunk) {
+        Violations &violations = faceViolations[chunk];
+        word_t code;
+        for (std::size_t face = begin; face < end; ++face)
+        {
+            if (face == faces.outerFace)
+            {
+                if (!circuit.empty() && faces.offsets[face + 1] - faces.offsets[face] != circuit.size())
+                {
+                    violations.add(face, "outer face has length ", faces.offsets[face + 1] - faces.offsets[face],
+                                   ", boundary circuit has ", circuit.size());
+                }
+                continue;
+            }
+            code.clear();
+            bool known = true;
+            for (std::size_t d = faces.offsets[face]; d < faces.offsets[face + 1] && known; ++d)
+            {
+                const auto &[v, i] = faces.darts[d];
+                code.emplace_back();
+                known = alphabet.encode(nodes[v].transitions()[i].label, code.back());
+            }
+            if (!known || !relations.count(canonical(code)))
+            {
+                std::ostringstream label;
+                for (std::size_t d = faces.offsets[face]; d < faces.offsets[face + 1]; ++d)
+                {
+                    const auto &[v, i] = faces.darts[d];
+                    label << (d == faces.offsets[face] ? "" : "*") << letterToString(nodes[v].transitions()[i].label);
+                }
+                violations.add(face, "face ", face, " at node ", faces.darts[faces.offsets[face]].first,
+                               " is not a relation: ", label.str());
+            }
+        }
+    });
+
+    if (report.faces != report.cells + 1)
+    {
+        global.add(0, "diagram has ", report.faces, " faces with outer one, but ", report.cells, " cells were bound");
+    }
+    if (report.nodes + report.faces != report.edges + 2)
+    {
+        global.add(0, "Euler formula does not hold: ", report.nodes, " nodes, ", report.edges, " edges, ",
+                   report.faces, " faces");
+    }
+
+    // Global violations first, then nodes, then faces
+    for (auto *group : {&nodeViolations, &faceViolations})
+    {
+        std::vector<std::pair<std::size_t, std::string>> found;
+        for (Violations &violations : *group)
+        {
+            global.count += violations.count;
+            found.insert(found.end(), violations.found.begin(), violations.found.end());
+        }
+        std::stable_sort(found.begin(), found.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+        for (auto &violation : found)
+        {
+            if (global.found.size() < global.limit)
+            {
+                global.found.push_back(std::move(violation));
+            }
+        }
+    }
+    report.violationsCount = global.count;
+    for (auto &violation : global.found)
+    {
+        report.violations.push_back(std::move(violation.second));
+    }
+    return report;
+}
+
+void printVerifyReport(const VerifyReport &report, std::ostream &os)
+{
+    os << "Verified " << report.nodes << " nodes, " << report.edges << " edges, " << report.faces << " faces: ";
+    if (report.ok())
+    {
+        os << "ok" << std::endl;
+        return;
+    }
+    os << report.violationsCount << " violations" << (report.violations.size() < report.violationsCount ? ", first ones:" : ":") << '\n';
+    for (const std::string &violation : report.violations)
+    {
+        os << "  " << violation << '\n';
+    }
+    os.flush();
+}
+} // namespace van_kampen
@@ -1,13 +1,27 @@
+#include <chrono>
 #include <filesystem>
 
 #include "cxxopts.hpp"
 
+#include "Analytics.hpp"
+#include "Compaction.hpp"
 #include "ConsoleFlags.hpp"
-#include "GraphSplitter.hpp"
+#include "Crossings.hpp"
+#include "DiagramLoader.hpp"
+#include "EdgePriorities.hpp"
+#include "EventLog.hpp"
+#include "Faces.hpp"
+#include "GraphPartitioner.hpp"
+#include "GraphStorage.hpp"
 #include "GroupRepresentationParser.hpp"
-#include "IterativeAlgorithm.hpp"
-#include "LargeFirstAlgorithm.hpp"
-#include "MergingAlgorithm.hpp"
+#include "Generation.hpp"
+#include "Layout.hpp"
+#include "LevelOfDetail.hpp"
+#include "Portfolio.hpp"
+#include "ResultCache.hpp"
+#include "Spectrum.hpp"
+#include "Utility.hpp"
+#include "Verifier.hpp"
 
 int main(int argc, const char **argv)
 {
@@ -16,61 +30,193 @@ int main(int argc, const char **argv)
     try
     {
         van_kampen::ConsoleFlags flags(argc, argv);
-        std::ifstream inputFile(flags.inputFileName);
-        if (!inputFile.good())
+        if (flags.maxMemory)
         {
-            throw std::invalid_argument("cannot open '" + flags.inputFileName + "'");
+            GraphStorage::setMemoryLimit(flags.maxMemory * 1024 * 1024);
         }
-        std::string text((std::istreambuf_iterator<char>(inputFile)),
-                         std::istreambuf_iterator<char>());
-
-        std::vector<std::vector<van_kampen::GroupElement>> words = van_kampen::GroupRepresentationParser::parse(text);
-        auto hub = words.back();
-        if (!flags.quiet)
+        // Relations of loaded diagram are needed only to verify it
+        std::vector<std::vector<van_kampen::GroupElement>> words;
+        if (!flags.inputFileName.empty())
+        {
+            std::ifstream inputFile(flags.inputFileName);
+            if (!inputFile.good())
+            {
+                throw std::invalid_argument("cannot open '" + flags.inputFileName + "'");
+            }
+            std::string text((std::istreambuf_iterator<char>(inputFile)),
+                             std::istreambuf_iterator<char>());
+            words = van_kampen::GroupRepresentationParser::parse(text);
+        }
+        if (!flags.quiet && !words.empty())
         {
             std::clog << "Total relations count: " << words.size() << std::endl;
-            std::clog << "Hub size: " << hub.size() << std::endl;
+            std::clog << "Hub size: " << words.back().size() << std::endl;
         }
-        words.pop_back();
-        if (flags.shuffleGroup)
+        GenerationParameters generation = flags.generation();
+        std::string description = describeParameters(generation);
+        if (flags.portfolio > 1)
         {
-            std::random_shuffle(words.begin(), words.end());
+            // Runs prepare words themselves, large-first ones vary per-large
+            description += ";portfolio=" + std::to_string(flags.portfolio) +
+                           ";seed=" + std::to_string(generation.seed) +
+                           ";shuffle=" + std::to_string(generation.shuffle) +
+                           ";sort=" + std::to_string(generation.sort) +
+                           ";affinity=" + std::to_string(generation.affinity ? generation.affinityK : 0);
+            if (generation.algorithm != algorithmType::LARGE_FIRST && portfolioAlternatesAlgorithms(generation))
+            {
+                // Iterative base gets large-first runs
+                description += ";per-large=" + std::to_string(generation.perLarge);
+            }
         }
-        if (!flags.notSort)
+        else if (flags.loadFileName.empty())
         {
-            std::stable_sort(words.begin(),
-                             words.end(),
-                             [](const std::vector<van_kampen::GroupElement> &a, const std::vector<van_kampen::GroupElement> &b) {
-                                 return a.size() < b.size();
-                             });
+            prepareWords(words, generation);
         }
-        words.push_back(hub);
-        std::unique_ptr<DiagrammGeneratingAlgorithm> algo;
-        if (flags.iterativeAlgo)
+        std::unique_ptr<DiagrammGeneratingAlgorithm> algo = makeAlgorithm(generation);
+
+        // Diagrams loaded from cache have no events, so cache is not used with log
+        std::ofstream eventLogFile;
+        std::unique_ptr<EventLog> eventLog;
+        if (!flags.eventLogFileName.empty())
         {
-            auto iterative = std::make_unique<IterativeAlgorithm>();
-            iterative->cellsLimit = flags.cellsLimit;
-            iterative->quiet = flags.quiet;
-            algo.reset(iterative.release());
+            if (flags.portfolio > 1)
+            {
+                throw std::invalid_argument("event log can not be written for portfolio runs");
+            }
+            if (!flags.loadFileName.empty())
+            {
+                throw std::invalid_argument("event log can not be written for loaded diagram");
+            }
+            if (generation.algorithm == algorithmType::LOOKAHEAD)
+            {
+                // Tried binds are rolled back in transactions, which are not logged
+                throw std::invalid_argument("event log can not be written for lookahead algorithm");
+            }
+            eventLogFile.open(flags.eventLogFileName, std::ios::binary);
+            if (!eventLogFile.good())
+            {
+                throw std::invalid_argument("cannot write to file '" + flags.eventLogFileName + "'");
+            }
+            eventLog = std::make_unique<EventLog>(eventLogFile);
+            algo->graph().setEventLog(eventLog.get());
         }
-        else if (flags.mergingAlgo)
+
+        std::unique_ptr<ResultCache> cache;
+        std::string cacheKey;
+        if (!flags.cacheDirectory.empty() && !eventLog && flags.loadFileName.empty())
         {
-            auto merging = std::make_unique<MergingAlgorithm>();
-            merging->limit = flags.cellsLimit;
-            merging->quiet = flags.quiet;
-            algo.reset(merging.release());
+            cache = std::make_unique<ResultCache>(flags.cacheDirectory, flags.cacheSize * 1024 * 1024);
+            cacheKey = ResultCache::makeKey(words, description);
         }
-        else if (flags.largeFirstAlgo)
+        if (!flags.loadFileName.empty())
         {
-            auto largeFirst = std::make_unique<LargeFirstAlgorithm>();
-            largeFirst->cellsLimit = flags.cellsLimit;
-            largeFirst->quiet = flags.quiet;
-            largeFirst->maximalSmallForOneBig = flags.perLarge;
-            algo.reset(largeFirst.release());
+            graphOutputFormat format = loadDiagram(flags.loadFileName, algo->graph(), algo->diagramm(), flags.threads);
+            if (!flags.quiet)
+            {
+                std::clog << "Loaded " << algo->graph().nodes().size() << " nodes from '" << flags.loadFileName << "'" << std::endl;
+                if (format != graphOutputFormat::BINARY)
+                {
+                    std::clog << "Text diagram has no boundary circuit and cells" << std::endl;
+                }
+            }
+            if (flags.verify && Node::isNonexistantNode(algo->diagramm().getTerminal()))
+            {
+                // Boundary and faces checks need terminal and cells of binary diagram
+                throw std::invalid_argument("loaded graph has no boundary circuit and cells to verify");
+            }
+            if (!flags.facesFileName.empty() && format != graphOutputFormat::BINARY)
+            {
+                // Text lists edges in their order, faces need clockwise transitions
+                throw std::invalid_argument("faces can not be enumerated on graph loaded from text");
+            }
+        }
+        else if (cache && cache->load(cacheKey, algo->diagramm()))
+        {
+            if (!flags.quiet)
+            {
+                std::clog << "Diagram loaded from cache" << std::endl;
+            }
+        }
+        else
+        {
+            if (flags.portfolio > 1)
+            {
+                PortfolioResult portfolio = runPortfolio(words, generation, flags.portfolio, flags.threads, !flags.portfolioAll);
+                if (!flags.quiet)
+                {
+                    printPortfolio(portfolio, std::clog);
+                }
+                algo = std::move(portfolio.best);
+            }
+            else
+            {
+                algo->generate(words);
+            }
+            if (!flags.quiet)
+            {
+                std::clog << "Matching time: "
+                          << std::chrono::duration<double>(algo->diagramm().matchingTime()).count() << " s" << std::endl;
+            }
+            if (cache)
+            {
+                cache->store(cacheKey, algo->diagramm());
+            }
+        }
+        if (eventLog)
+        {
+            algo->graph().setEventLog(nullptr);
+            eventLog.reset();
+        }
+        if (flags.compact)
+        {
+            std::size_t before = algo->graph().nodes().size();
+            algo->diagramm().compact(localityOrder(algo->graph(), algo->diagramm().getTerminal(), flags.compactOrder));
+            if (!flags.quiet)
+            {
+                std::clog << "Compacted " << before << " nodes to " << algo->graph().nodes().size() << std::endl;
+            }
+        }
+        if (flags.maxMemory && !flags.quiet)
+        {
+            std::clog << "Graph memory: " << GraphStorage::heapBytes() / (1024 * 1024) << " MB in RAM, "
+                      << GraphStorage::mappedBytes() / (1024 * 1024) << " MB in mapped file" << std::endl;
         }
 
-        algo->generate(words);
+        if (flags.layout)
+        {
+            LayoutParameters parameters;
+            parameters.threads = flags.threads;
+            parameters.forceIterations = flags.layoutIterations;
+            computeLayout(algo->graph(), algo->diagramm().getCircuit(), parameters);
+            if (!flags.coordinatesFileName.empty())
+            {
+                std::ofstream coordinatesFile(flags.coordinatesFileName);
+                if (!coordinatesFile.good())
+                {
+                    throw std::invalid_argument("cannot write to file '" + flags.coordinatesFileName + "'");
+                }
+                printCoordinates(algo->graph(), coordinatesFile);
+            }
+            if (!flags.crossingsFileName.empty())
+            {
+                std::ofstream crossingsFile(flags.crossingsFileName);
+                if (!crossingsFile.good())
+                {
+                    throw std::invalid_argument("cannot write to file '" + flags.crossingsFileName + "'");
+                }
+                CrossingParameters crossingParameters;
+                crossingParameters.threads = flags.threads;
+                CrossingReport crossings = countCrossings(algo->graph(), crossingParameters);
+                printCrossings(crossings, crossingsFile);
+                if (!flags.quiet)
+                {
+                    std::clog << "Crossings: " << crossings.crossings << " of " << crossings.edges << " edges" << std::endl;
+                }
+            }
+        }
 
+        // Circuit written with diagram is kept if loaded one has no terminal
+        if (flags.loadFileName.empty() || !Node::isNonexistantNode(algo->diagramm().getTerminal()))
         {
             std::ofstream wordOutputFile(flags.wordOutputFileName);
             if (!wordOutputFile.good())
@@ -79,44 +225,137 @@ int main(int argc, const char **argv)
             }
             else
             {
-                std::vector<van_kampen::Transition> word = algo->diagramm().getCircuit();
-                for (std::size_t i = 0; i < word.size(); ++i)
-                {
-                    auto &letter = word[i];
-                    wordOutputFile << letter.label.name << (letter.label.reversed ? "^(-1)" : "");
-                    if (i < word.size() - 1)
-                    {
-                        wordOutputFile << "*";
-                    }
-                }
+                wordOutputFile << circuitToString(algo->diagramm().getCircuit());
+            }
+        }
+
+        bool verified = true;
+        if (flags.verify)
+        {
+            VerifyParameters parameters;
+            parameters.threads = flags.threads;
+            std::ifstream circuitFile(flags.wordOutputFileName);
+            parameters.circuit.assign(std::istreambuf_iterator<char>(circuitFile), std::istreambuf_iterator<char>());
+            VerifyReport report = verifyDiagram(algo->graph(), algo->diagramm(), words, parameters);
+            verified = report.ok();
+            if (!verified || !flags.quiet)
+            {
+                printVerifyReport(report, verified ? std::clog : std::cerr);
+            }
+        }
+
+
+        if (!flags.facesFileName.empty())
+        {
+            std::ofstream facesFile(flags.facesFileName);
+            if (!facesFile.good())
+            {
+                throw std::invalid_argument("cannot write to file '" + flags.facesFileName + "'");
+            }
+            FaceList faces = enumerateFaces(algo->graph(), algo->diagramm());
+            printFaces(algo->graph(), faces, facesFile);
+            if (algo->diagramm().cellsCount() && faces.size() != algo->diagramm().cellsCount() + 1)
+            {
+                std::cerr << "warning: diagram has " << faces.size() - 1 << " inner faces, but "
+                          << algo->diagramm().cellsCount() << " cells were bound" << std::endl;
+            }
+        }
+
+        if (!flags.analyzeFileName.empty())
+        {
+            std::ofstream analyzeFile(flags.analyzeFileName);
+            if (!analyzeFile.good())
+            {
+                throw std::invalid_argument("cannot write to file '" + flags.analyzeFileName + "'");
             }
+            AnalyticsParameters parameters;
+            parameters.threads = flags.threads;
+            parameters.samples = flags.analyzeSamples;
+            printAnalytics(analyzeDiagram(algo->graph(), algo->diagramm(), parameters), analyzeFile);
         }
 
+        if (!flags.spectrumFileName.empty())
+        {
+            std::ofstream spectrumFile(flags.spectrumFileName);
+            if (!spectrumFile.good())
+            {
+                throw std::invalid_argument("cannot write to file '" + flags.spectrumFileName + "'");
+            }
+            SpectrumParameters parameters;
+            parameters.threads = flags.threads;
+            parameters.extremeCount = flags.spectrumCount;
+            parameters.bins = flags.spectrumBins;
+            parameters.lanczosSteps = flags.spectrumSteps;
+            printSpectrum(analyzeSpectrum(algo->graph(), parameters), spectrumFile);
+        }
 
-        if (!flags.split)
+        if (flags.lod)
+        {
+            computeEdgePriorities(algo->graph(), algo->diagramm().cells(), flags.threads);
+            DetailParameters parameters;
+            parameters.fanout = flags.lodFanout;
+            parameters.threads = flags.threads;
+            DetailHierarchy hierarchy = buildDetailLevels(algo->graph(), algo->diagramm().cells(), parameters);
+            if (!flags.quiet)
+            {
+                std::clog << "Detail levels:";
+                for (const DetailLevel &level : hierarchy.levels)
+                {
+                    std::clog << ' ' << level.size();
+                }
+                std::clog << std::endl;
+            }
+            std::filesystem::create_directory(flags.outputFileNameWoEx);
+            writeDetailLevels(algo->graph(), hierarchy, flags.outputFileNameWoEx, flags.outputFormat, flags.outputFormatString, flags.threads);
+        }
+        else if (!flags.split)
         {
-            std::ofstream outFile(flags.outputFileName);
+            std::ofstream outFile(flags.outputFileName, std::ios::binary);
             if (!outFile.good())
             {
                 throw std::invalid_argument("cannot write to file '" + flags.outputFileName + "'");
             }
-            algo->graph().printSelf(outFile, flags.outputFormat);
+            if (flags.outputFormat == graphOutputFormat::BINARY)
+            {
+                // Whole diagram with terminal and cells, so it can be loaded back
+                algo->diagramm().writeBinary(outFile);
+            }
+            else
+            {
+                algo->graph().printSelf(outFile, flags.outputFormat);
+            }
         }
         else
         {
-            std::deque<van_kampen::Graph> comps = splitToStrongComponents(algo->graph(), [](const Transition &tr) {
-                return tr.priority >= 0.01;
-            });
+            computeEdgePriorities(algo->graph(), algo->diagramm().cells(), flags.threads);
+            PartitionParameters parameters;
+            parameters.parts = flags.parts;
+            parameters.threads = flags.threads;
+            Partition partition = splitToParts(algo->graph(), partitionGraph(algo->graph(), parameters), flags.threads);
+            if (!flags.quiet)
+            {
+                std::clog << "Parts: " << partition.parts.size() << ", cut edges: " << partition.cut.size() << std::endl;
+            }
             std::filesystem::create_directory(flags.outputFileNameWoEx);
-            std::size_t compId = 1;
-            for (const van_kampen::Graph &comp : comps)
             {
-                if (comp.nodes().size() < 2)
-                    continue;
-                std::ofstream outFile(std::filesystem::path(flags.outputFileNameWoEx) / (std::to_string(compId) + "." + flags.outputFormatString));
-                comp.printSelf(outFile, flags.outputFormat);
-                ++compId;
+                std::ofstream cutFile(std::filesystem::path(flags.outputFileNameWoEx) / "cut.txt");
+                if (!cutFile.good())
+                {
+                    throw std::invalid_argument("cannot write to directory '" + flags.outputFileNameWoEx + "'");
+                }
+                printCutEdges(partition, cutFile);
             }
+            utility::parallelFor(partition.parts.size(), flags.threads, [&](std::size_t begin, std::size_t end, std::size_t) {
+                for (std::size_t partId = begin; partId < end; ++partId)
+                {
+                    std::ofstream outFile(std::filesystem::path(flags.outputFileNameWoEx) / (std::to_string(partId + 1) + "." + flags.outputFormatString));
+                    partition.parts[partId].printSelf(outFile, flags.outputFormat);
+                }
+            });
+        }
+        if (!verified)
+        {
+            return 1;
         }
     }
     catch (const std::exception &e)
@@ -0,0 +1,100 @@
+#include <fstream>
+
+#include "cxxopts.hpp"
+
+#include "EventLog.hpp"
+#include "Generation.hpp"
+#include "Layout.hpp"
+
+int main(int argc, const char **argv)
+{
+    using namespace van_kampen;
+
+    try
+    {
+        std::string inputFileName, outputFileName, wordOutputFileName, formatString = "dot";
+        bool quiet = false;
+        cxxopts::Options options("vankamp-replay", "Replay diagram event log into output format");
+        options.add_options()(
+            "i,input", "Specify event log file", cxxopts::value(inputFileName), "(required)")(
+            "f,format", "Output format", cxxopts::value(formatString), "dot/edges/svg")(
+            "o,output", "Specify output filename, '<input-filename>.<format>' by default", cxxopts::value(outputFileName), "")(
+            "c,circuit-output", "Write boundary circuit to file", cxxopts::value(wordOutputFileName), "")(
+            "q,quiet", "Do not log status to console", cxxopts::value(quiet)->default_value("false"), "")(
+            "h,help", "Print usage");
+        auto result = options.parse(argc, argv);
+        if (result.count("help"))
+        {
+            std::cout << options.help() << std::endl;
+            return 0;
+        }
+        if (!result.count("input"))
+        {
+            throw cxxopts::option_required_exception("input");
+        }
+        graphOutputFormat format;
+        if (formatString == "dot")
+        {
+            format = graphOutputFormat::DOT;
+        }
+        else if (formatString == "edges")
+        {
+            format = graphOutputFormat::TXT_EDGES;
+        }
+        else if (formatString == "svg")
+        {
+            format = graphOutputFormat::SVG;
+        }
+        else
+        {
+            throw cxxopts::invalid_option_format_error("Format can be either dot, edges or svg");
+        }
+        if (outputFileName.empty())
+        {
+            outputFileName = inputFileName + "." + formatString;
+        }
+
+        std::ifstream inputFile(inputFileName, std::ios::binary);
+        if (!inputFile.good())
+        {
+            throw std::invalid_argument("cannot open '" + inputFileName + "'");
+        }
+        auto graph = std::make_shared<Graph>();
+        Diagramm diagramm(graph);
+        ReplayResult replay = replayEventLog(inputFile, *graph, diagramm);
+        if (!quiet)
+        {
+            std::clog << "Events: " << replay.events << ", cells: " << replay.cells
+                      << ", nodes: " << graph->nodes().size() << std::endl;
+            if (!replay.complete)
+            {
+                std::clog << "Log is incomplete, " << replay.skipped << " events after the last cell are skipped" << std::endl;
+            }
+        }
+
+        if (format == graphOutputFormat::SVG)
+        {
+            computeLayout(*graph, diagramm.getCircuit(), LayoutParameters());
+        }
+        std::ofstream outFile(outputFileName);
+        if (!outFile.good())
+        {
+            throw std::invalid_argument("cannot write to file '" + outputFileName + "'");
+        }
+        graph->printSelf(outFile, format);
+        if (!wordOutputFileName.empty())
+        {
+            std::ofstream wordOutputFile(wordOutputFileName);
+            if (!wordOutputFile.good())
+            {
+                throw std::invalid_argument("cannot write to file '" + wordOutputFileName + "'");
+            }
+            wordOutputFile << circuitToString(diagramm.getCircuit());
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+}